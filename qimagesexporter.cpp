@@ -0,0 +1,149 @@
+#include "qimagesexporter.h"
+
+#include <QFileInfo>
+#include <QImageWriter>
+#include <QSaveFile>
+
+namespace {
+
+// 已写入这么多字节后才报告一次进度，避免逐块发送信号
+constexpr qint64 progressStep = 256 * 1024;
+
+/**
+ * @brief 可以在编码过程中取消并统计写入字节数的QSaveFile
+ */
+class ExportFile : public QSaveFile
+{
+public:
+    ExportFile(const QString &fileName, const QAtomicInt *cancelled,
+               const std::function<void(qint64)> &progress)
+        : QSaveFile(fileName), m_cancelled(cancelled), m_progress(progress) {}
+
+protected:
+    qint64 writeData(const char *data, qint64 len) override {
+        // 返回错误会使编码器中止
+        if (m_cancelled && m_cancelled->loadAcquire()) {
+            return -1;
+        }
+        auto written = QSaveFile::writeData(data, len);
+        if (written > 0) {
+            m_written += written;
+            if (m_progress && m_written - m_reported >= progressStep) {
+                m_reported = m_written;
+                m_progress(m_written);
+            }
+        }
+        return written;
+    }
+
+private:
+    const QAtomicInt *m_cancelled;
+    std::function<void(qint64)> m_progress;
+    qint64 m_written = 0;
+    qint64 m_reported = 0;
+};
+
+} // namespace
+
+QImagesExporter::QImagesExporter(QObject *parent) : QObject(parent) {
+    // 编码通常受限于磁盘，两个线程足以让编码与写入重叠
+    m_pool.setMaxThreadCount(2);
+}
+
+QImagesExporter::~QImagesExporter() {
+    cancelAll();
+    m_pool.waitForDone();
+}
+
+int QImagesExporter::save(const QImage &image, const QString &fileName,
+                          const QByteArray &format, int quality) {
+    int id = ++m_nextId;
+    auto cancelled = QSharedPointer<QAtomicInt>::create(0);
+    m_cancelFlags.insert(id, cancelled);
+
+    m_pool.start([this, id, image, fileName, format, quality, cancelled]() {
+        QString errorString;
+        bool ok = false;
+        if (cancelled->loadAcquire()) {
+            errorString = tr("Export cancelled");
+        } else {
+            ok = write(
+                image, fileName, format, quality, cancelled.data(),
+                [this, id](qint64 bytes) {
+                    QMetaObject::invokeMethod(
+                        this, [this, id, bytes]() { emit progress(id, bytes); },
+                        Qt::QueuedConnection);
+                },
+                &errorString);
+        }
+
+        QMetaObject::invokeMethod(
+            this,
+            [this, id, fileName, ok, errorString]() {
+                m_cancelFlags.remove(id);
+                emit finished(id, fileName, ok, errorString);
+            },
+            Qt::QueuedConnection);
+    });
+    return id;
+}
+
+void QImagesExporter::cancel(int id) {
+    if (auto flag = m_cancelFlags.value(id)) {
+        flag->storeRelease(1);
+    }
+}
+
+void QImagesExporter::cancelAll() {
+    for (const auto &flag : m_cancelFlags) {
+        flag->storeRelease(1);
+    }
+}
+
+bool QImagesExporter::isBusy() const { return !m_cancelFlags.isEmpty(); }
+
+void QImagesExporter::waitForDone() { m_pool.waitForDone(); }
+
+bool QImagesExporter::write(const QImage &image, const QString &fileName,
+                            const QByteArray &format, int quality,
+                            const QAtomicInt *cancelled,
+                            const std::function<void(qint64)> &progress,
+                            QString *errorString) {
+    auto fail = [errorString](const QString &message) {
+        if (errorString) {
+            *errorString = message;
+        }
+        return false;
+    };
+
+    if (image.isNull()) {
+        return fail(tr("Image is empty"));
+    }
+
+    ExportFile file(fileName, cancelled, progress);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return fail(file.errorString());
+    }
+
+    auto imageFormat =
+        format.isEmpty() ? QFileInfo(fileName).suffix().toLower().toLatin1()
+                         : format;
+    QImageWriter writer(&file, imageFormat);
+    if (quality >= 0) {
+        writer.setQuality(quality);
+    }
+
+    bool written = writer.write(image);
+    if (cancelled && cancelled->loadAcquire()) {
+        file.cancelWriting();
+        return fail(tr("Export cancelled"));
+    }
+    if (!written) {
+        file.cancelWriting();
+        return fail(writer.errorString());
+    }
+    if (!file.commit()) {
+        return fail(file.errorString());
+    }
+    return true;
+}
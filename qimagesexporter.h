@@ -0,0 +1,95 @@
+#ifndef QIMAGESEXPORTER_H
+#define QIMAGESEXPORTER_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QSharedPointer>
+#include <QString>
+#include <QThreadPool>
+
+#include <functional>
+
+/**
+ * @brief 在后台线程中编码并写出图像
+ *
+ * 场景渲染必须在GUI线程中完成，编码和写文件则交给工作线程，不会阻塞界面。
+ * 文件先写入临时文件，成功后才替换目标文件，取消或失败时不会留下不完整的文件。
+ * 结果通过finished()信号报告。
+ */
+class QImagesExporter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit QImagesExporter(QObject *parent = nullptr);
+
+    /**
+     * @brief 取消所有任务并等待正在运行的任务结束
+     */
+    ~QImagesExporter() override;
+
+    /**
+     * @brief 在后台保存图像
+     * @param image 要保存的图像
+     * @param fileName 目标文件名
+     * @param format 图像格式，为空时根据文件扩展名确定
+     * @param quality 压缩质量，-1表示使用默认值
+     * @return 任务编号，用于匹配progress()和finished()信号或取消任务
+     */
+    int save(const QImage &image, const QString &fileName,
+             const QByteArray &format = QByteArray(), int quality = -1);
+
+    /**
+     * @brief 取消指定任务，正在编码的任务会在下一次写入时中止
+     */
+    void cancel(int id);
+    void cancelAll();
+
+    /**
+     * @brief 是否还有未完成的任务
+     */
+    bool isBusy() const;
+
+    /**
+     * @brief 阻塞等待所有任务完成，已排队的信号仍在事件循环中发出
+     */
+    void waitForDone();
+
+    /**
+     * @brief 编码并写出图像，可在任意线程中调用
+     * @param cancelled 取消标志，非0时中止写入，可以为nullptr
+     * @param progress 已写入的字节数，在调用线程中回调，可以为空
+     * @param errorString 失败时的错误信息，可以为nullptr
+     * @return 写入成功时返回true
+     */
+    static bool write(const QImage &image, const QString &fileName,
+                      const QByteArray &format, int quality,
+                      const QAtomicInt *cancelled,
+                      const std::function<void(qint64)> &progress,
+                      QString *errorString);
+
+signals:
+    /**
+     * @brief 任务已写入的字节数，编码器逐块写出时发出
+     */
+    void progress(int id, qint64 bytesWritten);
+
+    /**
+     * @brief 任务完成、失败或被取消
+     * @param id 任务编号
+     * @param fileName 目标文件名
+     * @param ok 是否成功
+     * @param errorString 失败原因，成功时为空
+     */
+    void finished(int id, const QString &fileName, bool ok,
+                  const QString &errorString);
+
+private:
+    QThreadPool m_pool;
+    QHash<int, QSharedPointer<QAtomicInt>> m_cancelFlags;
+    int m_nextId = 0;
+};
+
+#endif // QIMAGESEXPORTER_H
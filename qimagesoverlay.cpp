@@ -0,0 +1,465 @@
+#include "qimagesoverlay.h"
+
+#include <QLineF>
+#include <QPainter>
+#include <QPolygonF>
+#include <QStyleOptionGraphicsItem>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// 图元数不超过该值时直接逐个比较，不建立索引
+constexpr int linearQueryLimit = 32;
+
+// 与QRectF::intersects不同，宽或高为0的矩形（单个点、水平线）也视为相交
+bool overlaps(const QRectF &a, const QRectF &b) {
+    return a.left() <= b.right() && b.left() <= a.right() &&
+           a.top() <= b.bottom() && b.top() <= a.bottom();
+}
+
+QRectF unite(const QRectF &a, const QRectF &b) {
+    return QRectF(QPointF(qMin(a.left(), b.left()), qMin(a.top(), b.top())),
+                  QPointF(qMax(a.right(), b.right()),
+                          qMax(a.bottom(), b.bottom())));
+}
+
+qreal penExtent(const QPen &pen) {
+    if (pen.style() == Qt::NoPen) {
+        return 0;
+    }
+    // 宽度为0的装饰性画笔按1像素计算，另留1像素给抗锯齿
+    return qMax<qreal>(1, pen.widthF()) / 2 + 1;
+}
+
+qreal distanceToSegment(const QPointF &p, const QPointF &a, const QPointF &b) {
+    QPointF ab = b - a;
+    qreal length2 = QPointF::dotProduct(ab, ab);
+    if (length2 <= 0) {
+        return QLineF(p, a).length();
+    }
+    qreal t = qBound<qreal>(0, QPointF::dotProduct(p - a, ab) / length2, 1);
+    return QLineF(p, a + t * ab).length();
+}
+
+bool nearPath(const QVector<QPointF> &points, bool closed, const QPointF &pos,
+              qreal tolerance) {
+    for (int i = 1; i < points.size(); i++) {
+        if (distanceToSegment(pos, points[i - 1], points[i]) <= tolerance) {
+            return true;
+        }
+    }
+    return closed && points.size() > 2 &&
+           distanceToSegment(pos, points.last(), points.first()) <= tolerance;
+}
+
+// 与前一个图元样式相同时不重新设置画笔和画刷
+void drawShape(QPainter *painter, const QImagesOverlayShape &shape,
+               const QImagesOverlayShape *previous) {
+    if (!previous || shape.pen != previous->pen) {
+        painter->setPen(shape.pen);
+    }
+    if (!previous || shape.brush != previous->brush) {
+        painter->setBrush(shape.brush);
+    }
+
+    int count = static_cast<int>(shape.points.size());
+    switch (shape.type) {
+    case QImagesOverlayShape::Points:
+        painter->drawPoints(shape.points.constData(), count);
+        break;
+    case QImagesOverlayShape::Polyline:
+        painter->drawPolyline(shape.points.constData(), count);
+        break;
+    case QImagesOverlayShape::Polygon:
+        painter->drawPolygon(shape.points.constData(), count);
+        break;
+    case QImagesOverlayShape::Rect:
+        painter->drawRect(shape.rect);
+        break;
+    case QImagesOverlayShape::Ellipse:
+        painter->drawEllipse(shape.rect);
+        break;
+    }
+}
+
+bool hitTest(const QImagesOverlayShape &shape, const QPointF &pos,
+             qreal tolerance) {
+    bool filled = shape.brush.style() != Qt::NoBrush;
+    switch (shape.type) {
+    case QImagesOverlayShape::Points:
+        for (const auto &point : shape.points) {
+            if (QLineF(point, pos).length() <= tolerance) {
+                return true;
+            }
+        }
+        return false;
+    case QImagesOverlayShape::Polyline:
+        return nearPath(shape.points, false, pos, tolerance);
+    case QImagesOverlayShape::Polygon:
+        return (filled &&
+                QPolygonF(shape.points).containsPoint(pos, Qt::OddEvenFill)) ||
+               nearPath(shape.points, true, pos, tolerance);
+    case QImagesOverlayShape::Rect: {
+        auto rect = shape.rect.normalized();
+        if (filled) {
+            return rect.adjusted(-tolerance, -tolerance, tolerance, tolerance)
+                .contains(pos);
+        }
+        QVector<QPointF> corners{rect.topLeft(), rect.topRight(),
+                                 rect.bottomRight(), rect.bottomLeft()};
+        return nearPath(corners, true, pos, tolerance);
+    }
+    case QImagesOverlayShape::Ellipse: {
+        // 用放大和缩小tolerance的两个椭圆近似轮廓的命中范围
+        auto rect = shape.rect.normalized();
+        auto inside = [&rect, &pos](qreal rx, qreal ry) {
+            if (rx <= 0 || ry <= 0) {
+                return false;
+            }
+            qreal dx = (pos.x() - rect.center().x()) / rx;
+            qreal dy = (pos.y() - rect.center().y()) / ry;
+            return dx * dx + dy * dy <= 1;
+        };
+        qreal rx = rect.width() / 2;
+        qreal ry = rect.height() / 2;
+        if (!inside(rx + tolerance, ry + tolerance)) {
+            return false;
+        }
+        return filled || !inside(rx - tolerance, ry - tolerance);
+    }
+    }
+    return false;
+}
+
+} // namespace
+
+QImagesOverlayShape::QImagesOverlayShape(Type type,
+                                         const QVector<QPointF> &points,
+                                         const QPen &pen, const QBrush &brush)
+    : type(type), points(points), pen(pen), brush(brush) {}
+
+QImagesOverlayShape::QImagesOverlayShape(Type type, const QRectF &rect,
+                                         const QPen &pen, const QBrush &brush)
+    : type(type), rect(rect), pen(pen), brush(brush) {}
+
+QRectF QImagesOverlayShape::boundingRect() const {
+    if (type == Rect || type == Ellipse) {
+        return rect.normalized();
+    }
+    if (points.isEmpty()) {
+        return QRectF();
+    }
+    qreal left = points.first().x();
+    qreal right = left;
+    qreal top = points.first().y();
+    qreal bottom = top;
+    for (const auto &point : points) {
+        left = qMin(left, point.x());
+        right = qMax(right, point.x());
+        top = qMin(top, point.y());
+        bottom = qMax(bottom, point.y());
+    }
+    return QRectF(QPointF(left, top), QPointF(right, bottom));
+}
+
+void QImagesOverlayModel::Layer::append(const QImagesOverlayShape &shape) {
+    auto rect = shape.boundingRect();
+    boundingRect = shapes.isEmpty() ? rect : unite(boundingRect, rect);
+    shapes.append(shape);
+    bounds.append(rect);
+    penMargin = qMax(penMargin, penExtent(shape.pen));
+    indexed = false;
+}
+
+QVector<int> QImagesOverlayModel::Layer::query(const QRectF &rect) const {
+    QVector<int> result;
+    if (shapes.isEmpty() || !overlaps(rect, boundingRect)) {
+        return result;
+    }
+
+    int count = static_cast<int>(shapes.size());
+    // 整个图层都可见时不需要逐个比较
+    if (rect.contains(boundingRect)) {
+        result.resize(count);
+        for (int i = 0; i < count; i++) {
+            result[i] = i;
+        }
+        return result;
+    }
+
+    if (count <= linearQueryLimit) {
+        for (int i = 0; i < count; i++) {
+            if (overlaps(bounds[i], rect)) {
+                result.append(i);
+            }
+        }
+        return result;
+    }
+
+    if (!indexed) {
+        buildIndex();
+    }
+    auto cells = gridCells(rect);
+    for (int y = cells.top(); y <= cells.bottom(); y++) {
+        for (int x = cells.left(); x <= cells.right(); x++) {
+            for (int id : grid[y * gridSize.width() + x]) {
+                if (overlaps(bounds[id], rect)) {
+                    result.append(id);
+                }
+            }
+        }
+    }
+
+    // 跨越多个网格的图元会重复出现，按序号排序保持绘制顺序
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+void QImagesOverlayModel::Layer::buildIndex() const {
+    // 平均每个网格约4个图元
+    int count = static_cast<int>(shapes.size());
+    int side = qBound(1, static_cast<int>(std::sqrt(count / 4.0)), 64);
+    gridSize = QSize(side, side);
+    grid = QVector<QVector<int>>(side * side);
+    for (int i = 0; i < count; i++) {
+        auto cells = gridCells(bounds[i]);
+        for (int y = cells.top(); y <= cells.bottom(); y++) {
+            for (int x = cells.left(); x <= cells.right(); x++) {
+                grid[y * side + x].append(i);
+            }
+        }
+    }
+    indexed = true;
+}
+
+QRect QImagesOverlayModel::Layer::gridCells(const QRectF &rect) const {
+    auto cell = [](qreal value, qreal origin, qreal extent, int cells) {
+        if (extent <= 0) {
+            return 0;
+        }
+        int position =
+            static_cast<int>(std::floor((value - origin) / extent * cells));
+        return qBound(0, position, cells - 1);
+    };
+    return QRect(
+        QPoint(cell(rect.left(), boundingRect.left(), boundingRect.width(),
+                    gridSize.width()),
+               cell(rect.top(), boundingRect.top(), boundingRect.height(),
+                    gridSize.height())),
+        QPoint(cell(rect.right(), boundingRect.left(), boundingRect.width(),
+                    gridSize.width()),
+               cell(rect.bottom(), boundingRect.top(), boundingRect.height(),
+                    gridSize.height())));
+}
+
+QImagesOverlayModel::QImagesOverlayModel(QObject *parent) : QObject(parent) {}
+
+QImagesOverlayModel::~QImagesOverlayModel() = default;
+
+int QImagesOverlayModel::addShape(size_t index,
+                                  const QImagesOverlayShape &shape) {
+    auto &layer = m_layers[index];
+    layer.append(shape);
+    emit changed(index);
+    return static_cast<int>(layer.shapes.size()) - 1;
+}
+
+void QImagesOverlayModel::addShapes(size_t index,
+                                    const QVector<QImagesOverlayShape> &shapes) {
+    if (shapes.isEmpty()) {
+        return;
+    }
+    auto &layer = m_layers[index];
+    layer.shapes.reserve(layer.shapes.size() + shapes.size());
+    layer.bounds.reserve(layer.bounds.size() + shapes.size());
+    for (const auto &shape : shapes) {
+        layer.append(shape);
+    }
+    emit changed(index);
+}
+
+void QImagesOverlayModel::setShapes(size_t index,
+                                    const QVector<QImagesOverlayShape> &shapes) {
+    m_layers.remove(index);
+    if (shapes.isEmpty()) {
+        emit changed(index);
+        return;
+    }
+    addShapes(index, shapes);
+}
+
+QVector<QImagesOverlayShape> QImagesOverlayModel::shapes(size_t index) const {
+    return m_layers.value(index).shapes;
+}
+
+int QImagesOverlayModel::shapeCount(size_t index) const {
+    auto layer = m_layers.constFind(index);
+    return layer == m_layers.constEnd()
+               ? 0
+               : static_cast<int>(layer->shapes.size());
+}
+
+bool QImagesOverlayModel::hasShapes(size_t index) const {
+    return shapeCount(index) > 0;
+}
+
+QRectF QImagesOverlayModel::boundingRect(size_t index) const {
+    auto layer = m_layers.constFind(index);
+    return layer == m_layers.constEnd() ? QRectF() : layer->boundingRect;
+}
+
+qreal QImagesOverlayModel::penMargin(size_t index) const {
+    auto layer = m_layers.constFind(index);
+    return layer == m_layers.constEnd() ? 0 : layer->penMargin;
+}
+
+void QImagesOverlayModel::clear(size_t index) {
+    if (m_layers.remove(index) > 0) {
+        emit changed(index);
+    }
+}
+
+void QImagesOverlayModel::clearAll() {
+    m_layers.clear();
+    emit reset();
+}
+
+QVector<int> QImagesOverlayModel::shapesIn(size_t index,
+                                           const QRectF &rect) const {
+    auto layer = m_layers.constFind(index);
+    if (layer == m_layers.constEnd()) {
+        return QVector<int>();
+    }
+    return layer->query(rect);
+}
+
+int QImagesOverlayModel::shapeAt(size_t index, const QPointF &pos,
+                                 qreal tolerance) const {
+    auto layer = m_layers.constFind(index);
+    if (layer == m_layers.constEnd()) {
+        return -1;
+    }
+
+    QRectF area(pos.x() - tolerance, pos.y() - tolerance, 2 * tolerance,
+                2 * tolerance);
+    auto ids = layer->query(area);
+    // 后添加的图元绘制在上层，优先命中
+    for (int i = static_cast<int>(ids.size()) - 1; i >= 0; i--) {
+        if (hitTest(layer->shapes[ids[i]], pos, tolerance)) {
+            return ids[i];
+        }
+    }
+    return -1;
+}
+
+void QImagesOverlayModel::paint(QPainter *painter, size_t index,
+                                const QRectF &exposed) const {
+    auto layer = m_layers.constFind(index);
+    if (layer == m_layers.constEnd() || layer->shapes.isEmpty()) {
+        return;
+    }
+
+    // 装饰性画笔的宽度以设备像素计，缩小显示时在场景坐标中更宽
+    qreal margin = layer->penMargin;
+    qreal lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+        painter->worldTransform());
+    if (lod > 0) {
+        margin = qMax(margin, margin / lod);
+    }
+    auto ids = layer->query(exposed.adjusted(-margin, -margin, margin, margin));
+    if (ids.isEmpty()) {
+        return;
+    }
+
+    painter->save();
+    const QImagesOverlayShape *previous = nullptr;
+    for (int id : ids) {
+        const auto &shape = layer->shapes[id];
+        drawShape(painter, shape, previous);
+        previous = &shape;
+    }
+    painter->restore();
+}
+
+void QImagesOverlayModel::paintShapes(
+    QPainter *painter, const QVector<QImagesOverlayShape> &shapes) {
+    if (shapes.isEmpty()) {
+        return;
+    }
+
+    painter->save();
+    const QImagesOverlayShape *previous = nullptr;
+    for (const auto &shape : shapes) {
+        drawShape(painter, shape, previous);
+        previous = &shape;
+    }
+    painter->restore();
+}
+
+QImagesOverlayItem::QImagesOverlayItem(QGraphicsItem *parent)
+    : QGraphicsItem(parent) {
+    // 需要exposedRect确定可见的图元
+    setFlag(ItemUsesExtendedStyleOption);
+}
+
+QImagesOverlayItem::~QImagesOverlayItem() = default;
+
+QImagesOverlayModel *QImagesOverlayItem::model() const { return m_model; }
+
+qint64 QImagesOverlayItem::imageIndex() const { return m_index; }
+
+void QImagesOverlayItem::setSource(QImagesOverlayModel *model, qint64 index) {
+    if (m_model == model && m_index == index) {
+        return;
+    }
+    m_model = model;
+    m_index = index;
+    refresh();
+}
+
+void QImagesOverlayItem::refresh() {
+    prepareGeometryChange();
+    m_bounds = QRectF();
+    if (!isEmpty()) {
+        auto index = static_cast<size_t>(m_index);
+        // 与paint()一致，按最小细节级别下装饰性画笔的宽度留出余量
+        qreal margin = m_model->penMargin(index);
+        margin = qMax(margin, margin / m_minimumLod);
+        m_bounds = m_model->boundingRect(index).adjusted(-margin, -margin,
+                                                         margin, margin);
+    }
+    update();
+}
+
+qreal QImagesOverlayItem::minimumLevelOfDetail() const { return m_minimumLod; }
+
+void QImagesOverlayItem::setMinimumLevelOfDetail(qreal lod) {
+    lod = lod > 0 ? lod : 1.0;
+    if (qFuzzyCompare(m_minimumLod, lod)) {
+        return;
+    }
+    m_minimumLod = lod;
+    refresh();
+}
+
+bool QImagesOverlayItem::isEmpty() const {
+    return !m_model || m_index < 0 ||
+           !m_model->hasShapes(static_cast<size_t>(m_index));
+}
+
+int QImagesOverlayItem::type() const { return Type; }
+
+QRectF QImagesOverlayItem::boundingRect() const { return m_bounds; }
+
+void QImagesOverlayItem::paint(QPainter *painter,
+                               const QStyleOptionGraphicsItem *option,
+                               QWidget *widget) {
+    Q_UNUSED(widget);
+    if (isEmpty()) {
+        return;
+    }
+    m_model->paint(painter, static_cast<size_t>(m_index), option->exposedRect);
+}
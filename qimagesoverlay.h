@@ -0,0 +1,224 @@
+#ifndef QIMAGESOVERLAY_H
+#define QIMAGESOVERLAY_H
+
+#include <QBrush>
+#include <QGraphicsItem>
+#include <QHash>
+#include <QObject>
+#include <QPen>
+#include <QPointer>
+#include <QRectF>
+#include <QSize>
+#include <QVector>
+
+/**
+ * @brief 图形层中的一个图元
+ * @details 坐标为场景坐标，与QImagesWidget::addItem()添加的图形项相同，原点为图像中心
+ */
+struct QImagesOverlayShape {
+    enum Type {
+        Points,   ///< 独立的点
+        Polyline, ///< 折线，例如轮廓线
+        Polygon,  ///< 闭合多边形
+        Rect,     ///< 矩形，例如感兴趣区域
+        Ellipse   ///< rect的内切椭圆
+    };
+
+    QImagesOverlayShape() = default;
+    QImagesOverlayShape(Type type, const QVector<QPointF> &points,
+                        const QPen &pen = QPen(Qt::green, 0),
+                        const QBrush &brush = Qt::NoBrush);
+    QImagesOverlayShape(Type type, const QRectF &rect,
+                        const QPen &pen = QPen(Qt::green, 0),
+                        const QBrush &brush = Qt::NoBrush);
+
+    /**
+     * @brief 图元的外接矩形，不包括画笔宽度
+     */
+    QRectF boundingRect() const;
+
+    Type type = Polyline;
+    QVector<QPointF> points; ///< Points、Polyline和Polygon的顶点
+    QRectF rect;             ///< Rect和Ellipse的外接矩形
+    QPen pen{Qt::green, 0};  ///< 宽度为0时为1像素宽的装饰性画笔，不随缩放变粗
+    QBrush brush{Qt::NoBrush};
+};
+
+/**
+ * @brief 按图像索引保存的持久图形层
+ *
+ * 图元只保存一次，与当前显示哪些图像无关；翻页或更新图像时显示该图像的单元
+ * 重新关联到对应的图元，不会删除或重新创建图形项。每张图像的图元建有均匀网格的
+ * 空间索引，在首次查询时建立，绘制和命中测试只访问与查询区域相交的图元。
+ * 只能在GUI线程中使用。
+ */
+class QImagesOverlayModel : public QObject
+{
+    Q_OBJECT
+public:
+    explicit QImagesOverlayModel(QObject *parent = nullptr);
+    ~QImagesOverlayModel() override;
+
+    /**
+     * @brief 为图像追加一个图元
+     * @param index 图像索引
+     * @param shape 图元
+     * @return 图元在该图像中的序号
+     */
+    int addShape(size_t index, const QImagesOverlayShape &shape);
+
+    /**
+     * @brief 为图像追加多个图元，只发出一次changed()
+     */
+    void addShapes(size_t index, const QVector<QImagesOverlayShape> &shapes);
+
+    /**
+     * @brief 替换图像的全部图元
+     */
+    void setShapes(size_t index, const QVector<QImagesOverlayShape> &shapes);
+
+    QVector<QImagesOverlayShape> shapes(size_t index) const;
+    int shapeCount(size_t index) const;
+    bool hasShapes(size_t index) const;
+
+    /**
+     * @brief 图像所有图元的外接矩形，不包括画笔宽度
+     */
+    QRectF boundingRect(size_t index) const;
+
+    /**
+     * @brief 删除图像的全部图元
+     */
+    void clear(size_t index);
+
+    /**
+     * @brief 删除所有图像的图元，发出reset()
+     */
+    void clearAll();
+
+    /**
+     * @brief 查找外接矩形与区域相交的图元
+     * @return 按绘制顺序排列的图元序号
+     */
+    QVector<int> shapesIn(size_t index, const QRectF &rect) const;
+
+    /**
+     * @brief 查找位置上最上层的图元
+     * @param pos 场景坐标
+     * @param tolerance 允许的距离（场景坐标），用于点、线和未填充的轮廓
+     * @return 图元序号，没有时返回-1
+     */
+    int shapeAt(size_t index, const QPointF &pos, qreal tolerance = 2.0) const;
+
+    /**
+     * @brief 绘制与区域相交的图元
+     * @details 相邻的同样式图元共用画笔和画刷设置
+     * @param painter 画家，坐标系为场景坐标
+     * @param index 图像索引
+     * @param exposed 需要绘制的区域（场景坐标）
+     */
+    void paint(QPainter *painter, size_t index, const QRectF &exposed) const;
+
+    /**
+     * @brief 依次绘制一组图元，不经过空间索引
+     * @details 不访问模型，可以在工作线程中绘制shapes()返回的副本
+     * @param painter 画家，坐标系为场景坐标
+     */
+    static void paintShapes(QPainter *painter,
+                            const QVector<QImagesOverlayShape> &shapes);
+
+    /**
+     * @brief 画笔超出图元外接矩形的最大距离
+     * @details 装饰性画笔以设备像素为单位，其他画笔以场景坐标为单位
+     */
+    qreal penMargin(size_t index) const;
+
+signals:
+    /**
+     * @brief 图像的图元发生变化
+     */
+    void changed(size_t index);
+
+    /**
+     * @brief 所有图元被删除
+     */
+    void reset();
+
+private:
+    struct Layer {
+        QVector<QImagesOverlayShape> shapes;
+        QVector<QRectF> bounds;
+        QRectF boundingRect;
+        qreal penMargin = 0;
+
+        // 均匀网格索引，修改后失效，在下一次查询时重建
+        mutable QVector<QVector<int>> grid;
+        mutable QSize gridSize;
+        mutable bool indexed = false;
+
+        void append(const QImagesOverlayShape &shape);
+        QVector<int> query(const QRectF &rect) const;
+        void buildIndex() const;
+        QRect gridCells(const QRectF &rect) const;
+    };
+
+    QHash<size_t, Layer> m_layers;
+};
+
+/**
+ * @brief 绘制QImagesOverlayModel中一张图像全部图元的图形项
+ *
+ * 一个图形项绘制任意多个图元，代替为每个点或轮廓创建一个QGraphicsItem；
+ * 只绘制与暴露区域相交的图元
+ */
+class QImagesOverlayItem : public QGraphicsItem
+{
+public:
+    enum { Type = UserType + 2 };
+
+    explicit QImagesOverlayItem(QGraphicsItem *parent = nullptr);
+    ~QImagesOverlayItem() override;
+
+    QImagesOverlayModel *model() const;
+    qint64 imageIndex() const;
+
+    /**
+     * @brief 关联到模型中的一张图像
+     * @param model 图形层模型，图形项不接管其所有权
+     * @param index 图像索引，-1表示不显示任何图元
+     */
+    void setSource(QImagesOverlayModel *model, qint64 index);
+
+    /**
+     * @brief 模型中该图像的图元变化后重新计算范围并重绘
+     */
+    void refresh();
+
+    qreal minimumLevelOfDetail() const;
+
+    /**
+     * @brief 设置预期的最小细节级别，用于计算装饰性画笔在场景坐标中的最大宽度
+     * @details 装饰性画笔以设备像素为单位，缩小显示时在场景坐标中变宽，边界矩形
+     *          按该级别留出余量。默认0.25，与QImagesWidget的最小缩放比例一致
+     * @param lod 最小细节级别，不大于0时按1处理
+     */
+    void setMinimumLevelOfDetail(qreal lod);
+
+    /**
+     * @brief 是否没有要绘制的图元
+     */
+    bool isEmpty() const;
+
+    int type() const override;
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+               QWidget *widget = nullptr) override;
+
+private:
+    QPointer<QImagesOverlayModel> m_model;
+    qint64 m_index = -1;
+    qreal m_minimumLod = 0.25;
+    QRectF m_bounds;
+};
+
+#endif // QIMAGESOVERLAY_H
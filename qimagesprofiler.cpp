@@ -0,0 +1,158 @@
+#include "qimagesprofiler.h"
+
+#include <QAtomicInt>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QVector>
+
+namespace {
+
+struct TraceEvent {
+    QImagesProfileStats::Section section;
+    qint64 startNs;
+    qint64 durationNs;
+    quintptr thread;
+};
+
+struct ProfilerState {
+    QAtomicInt enabled;
+    QElapsedTimer clock;
+    QMutex mutex;
+    QImagesProfileStats stats;
+    QVector<TraceEvent> events; ///< 环形缓冲区
+    int nextEvent = 0;
+    int capacity = 65536;
+
+    ProfilerState() { clock.start(); }
+};
+
+ProfilerState &state() {
+    static ProfilerState profiler;
+    return profiler;
+}
+
+} // namespace
+
+const char *QImagesProfileStats::sectionName(Section section) {
+    switch (section) {
+    case UpdateGrid:
+        return "updateGrid";
+    case UpdateMarkers:
+        return "updateMarkers";
+    case ScaleImage:
+        return "scaleImage";
+    case PixmapUpload:
+        return "pixmapUpload";
+    case SetPixmap:
+        return "setPixmap";
+    case Render:
+        return "render";
+    default:
+        return "unknown";
+    }
+}
+
+bool QImagesProfiler::isEnabled() {
+    return state().enabled.loadAcquire() != 0;
+}
+
+void QImagesProfiler::setEnabled(bool enable) {
+    state().enabled.storeRelease(enable ? 1 : 0);
+}
+
+qint64 QImagesProfiler::now() { return state().clock.nsecsElapsed(); }
+
+void QImagesProfiler::record(QImagesProfileStats::Section section,
+                             qint64 startNs, qint64 durationNs) {
+    auto &profiler = state();
+    QMutexLocker locker(&profiler.mutex);
+
+    auto &timing = profiler.stats.timings[section];
+    timing.calls++;
+    timing.totalNs += durationNs;
+    timing.maxNs = qMax(timing.maxNs, durationNs);
+
+    if (profiler.capacity <= 0) {
+        return;
+    }
+    TraceEvent event{section, startNs, durationNs,
+                     reinterpret_cast<quintptr>(QThread::currentThreadId())};
+    if (profiler.events.size() < profiler.capacity) {
+        profiler.events.append(event);
+    } else {
+        profiler.events[profiler.nextEvent] = event;
+    }
+    profiler.nextEvent = (profiler.nextEvent + 1) % profiler.capacity;
+}
+
+void QImagesProfiler::count(QImagesProfileStats::Counter counter, quint64 n) {
+    auto &profiler = state();
+    QMutexLocker locker(&profiler.mutex);
+    profiler.stats.counters[counter] += n;
+}
+
+QImagesProfileStats QImagesProfiler::stats() {
+    auto &profiler = state();
+    QMutexLocker locker(&profiler.mutex);
+    return profiler.stats;
+}
+
+void QImagesProfiler::reset() {
+    auto &profiler = state();
+    QMutexLocker locker(&profiler.mutex);
+    profiler.stats = QImagesProfileStats();
+    profiler.events.clear();
+    profiler.nextEvent = 0;
+}
+
+void QImagesProfiler::setTraceCapacity(int events) {
+    auto &profiler = state();
+    QMutexLocker locker(&profiler.mutex);
+    profiler.capacity = qMax(0, events);
+    profiler.events.clear();
+    profiler.nextEvent = 0;
+}
+
+QByteArray QImagesProfiler::chromeTrace() {
+    QVector<TraceEvent> events;
+    int first = 0;
+    {
+        auto &profiler = state();
+        QMutexLocker locker(&profiler.mutex);
+        events = profiler.events;
+        // 缓冲区已满时最早的事件位于nextEvent
+        if (events.size() == profiler.capacity) {
+            first = profiler.nextEvent;
+        }
+    }
+
+    QByteArray json("{\"traceEvents\":[");
+    for (int i = 0; i < events.size(); i++) {
+        const auto &event = events[(first + i) % events.size()];
+        if (i > 0) {
+            json += ',';
+        }
+        // 时间以微秒为单位
+        json += "{\"name\":\"";
+        json += QImagesProfileStats::sectionName(event.section);
+        json += "\",\"cat\":\"QImagesWidget\",\"ph\":\"X\",\"pid\":1,\"tid\":";
+        json += QByteArray::number(static_cast<qulonglong>(event.thread));
+        json += ",\"ts\":";
+        json += QByteArray::number(event.startNs / 1000.0, 'f', 3);
+        json += ",\"dur\":";
+        json += QByteArray::number(event.durationNs / 1000.0, 'f', 3);
+        json += '}';
+    }
+    json += "]}";
+    return json;
+}
+
+bool QImagesProfiler::writeChromeTrace(const QString &fileName) {
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    return file.write(chromeTrace()) >= 0;
+}
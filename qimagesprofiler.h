@@ -0,0 +1,133 @@
+#ifndef QIMAGESPROFILER_H
+#define QIMAGESPROFILER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QString>
+#include <QtGlobal>
+
+/**
+ * @brief 性能统计数据
+ */
+struct QImagesProfileStats {
+    /**
+     * @brief 被计时的代码段
+     */
+    enum Section {
+        UpdateGrid,    ///< QImagesWidget::updateGrid()
+        UpdateMarkers, ///< QImagesWidget::updateMarkers()
+        ScaleImage,    ///< 单张图像的缩放（包括工作线程）
+        PixmapUpload,  ///< QImage到QPixmap的转换
+        SetPixmap,     ///< QImagesWidgetItemView设置图像，包括清空场景
+        Render,        ///< 批量绘制、拼图和导出时的渲染
+        SectionCount
+    };
+
+    /**
+     * @brief 计数器
+     */
+    enum Counter {
+        ImagesScaled,   ///< 缩放的图像数
+        PixmapsCreated, ///< 创建的QPixmap数
+        ViewsAllocated, ///< 新创建（而不是从复用池取出）的单元视图数
+        CounterCount
+    };
+
+    struct Timing {
+        quint64 calls = 0;
+        qint64 totalNs = 0;
+        qint64 maxNs = 0;
+    };
+
+    Timing timings[SectionCount];
+    quint64 counters[CounterCount] = {};
+
+    static const char* sectionName(Section section);
+};
+
+/**
+ * @brief 热点路径的计时和计数
+ *
+ * 只有定义了QIMAGESWIDGET_ENABLE_PROFILING时QIMAGES_PROFILE_*宏才会生成代码，
+ * 否则完全不参与编译；编译进来后还需要setEnabled(true)，禁用时每个计时点只有一次原子读取。
+ * 所有函数都是线程安全的，工作线程中的缩放也会被记录。
+ */
+class QImagesProfiler
+{
+public:
+    static bool isEnabled();
+    static void setEnabled(bool enable);
+
+    static void record(QImagesProfileStats::Section section, qint64 startNs,
+                       qint64 durationNs);
+    static void count(QImagesProfileStats::Counter counter, quint64 n = 1);
+
+    static QImagesProfileStats stats();
+
+    /**
+     * @brief 清空统计数据和记录的事件
+     */
+    static void reset();
+
+    /**
+     * @brief 设置保留的事件数，超出时丢弃最早的事件
+     * @param events 事件数，默认为65536
+     */
+    static void setTraceCapacity(int events);
+
+    /**
+     * @brief 以Chrome trace-event格式导出记录的事件
+     * @details 可以在chrome://tracing或Perfetto中打开
+     */
+    static QByteArray chromeTrace();
+    static bool writeChromeTrace(const QString& fileName);
+
+    /**
+     * @brief 当前时间（纳秒），所有事件使用同一时钟
+     */
+    static qint64 now();
+
+    /**
+     * @brief 作用域计时器，析构时记录耗时
+     */
+    class Scope
+    {
+    public:
+        explicit Scope(QImagesProfileStats::Section section)
+            : m_section(section),
+              m_start(QImagesProfiler::isEnabled() ? QImagesProfiler::now()
+                                                   : -1) {}
+        ~Scope() {
+            if (m_start >= 0) {
+                QImagesProfiler::record(m_section, m_start,
+                                        QImagesProfiler::now() - m_start);
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        QImagesProfileStats::Section m_section;
+        qint64 m_start;
+    };
+};
+
+#ifdef QIMAGESWIDGET_ENABLE_PROFILING
+#define QIMAGES_PROFILE_SCOPE(section)                                         \
+    QImagesProfiler::Scope qimagesProfileScope(QImagesProfileStats::section)
+#define QIMAGES_PROFILE_COUNT(counter, n)                                      \
+    do {                                                                       \
+        if (QImagesProfiler::isEnabled())                                      \
+            QImagesProfiler::count(QImagesProfileStats::counter, n);           \
+    } while (0)
+#else
+#define QIMAGES_PROFILE_SCOPE(section)                                         \
+    do {                                                                       \
+    } while (0)
+#define QIMAGES_PROFILE_COUNT(counter, n)                                      \
+    do {                                                                       \
+    } while (0)
+#endif
+
+#endif // QIMAGESPROFILER_H
@@ -0,0 +1,322 @@
+#include "qimagesprovider.h"
+#include "utils.h"
+
+#include <QCollator>
+#include <QDir>
+#include <QImageReader>
+#include <QMutexLocker>
+#include <QReadLocker>
+#include <QSet>
+#include <QWriteLocker>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+
+QImagesProvider::QImagesProvider(QObject *parent) : QObject(parent) {}
+
+QImagesProvider::~QImagesProvider() = default;
+
+QSize QImagesProvider::imageSize(size_t index) const {
+    auto image = this->image(index);
+    return image.isNull() ? QSize() : image.size();
+}
+
+qint64 QImagesProvider::memoryUsage() const { return 0; }
+
+QImagesMemoryProvider::QImagesMemoryProvider(QObject *parent)
+    : QImagesProvider(parent) {}
+
+QImagesMemoryProvider::~QImagesMemoryProvider() = default;
+
+qint64 QImagesMemoryProvider::memoryUsage() const {
+    QReadLocker locker(&m_lock);
+    // 共享同一数据的图像只计算一次
+    QSet<qint64> counted;
+    qint64 bytes = 0;
+    for (const auto &image : m_images) {
+        if (!image.isNull() && !counted.contains(image.cacheKey())) {
+            counted.insert(image.cacheKey());
+            bytes += image.sizeInBytes();
+        }
+    }
+    return bytes;
+}
+
+bool QImagesMemoryProvider::isCompactStorage() const {
+    QReadLocker locker(&m_lock);
+    return m_compactStorage;
+}
+
+void QImagesMemoryProvider::setCompactStorage(bool enable) {
+    QWriteLocker locker(&m_lock);
+    m_compactStorage = enable;
+}
+
+QImage QImagesMemoryProvider::compactImage(const QImage &image) {
+    switch (image.format()) {
+    case QImage::Format_Indexed8:
+    case QImage::Format_RGB32:
+    case QImage::Format_RGB888:
+    case QImage::Format_RGBX8888:
+        break;
+    default:
+        // 已经是灰度格式，或者转换会丢失透明度或精度
+        return image;
+    }
+    if (!image.isGrayscale()) {
+        return image;
+    }
+    return image.convertToFormat(QImage::Format_Grayscale8);
+}
+
+QList<QImage>
+QImagesMemoryProvider::compactImages(const QList<QImage> &images) const {
+    if (!isCompactStorage()) {
+        return images;
+    }
+    QList<QImage> result;
+    result.reserve(images.size());
+    for (const auto &image : images) {
+        result.append(compactImage(image));
+    }
+    return result;
+}
+
+size_t QImagesMemoryProvider::count() const {
+    QReadLocker locker(&m_lock);
+    return static_cast<size_t>(m_images.size());
+}
+
+QImage QImagesMemoryProvider::image(size_t index) const {
+    QReadLocker locker(&m_lock);
+    if (index >= static_cast<size_t>(m_images.size())) {
+        return QImage();
+    }
+    return m_images[static_cast<int>(index)];
+}
+
+void QImagesMemoryProvider::setImages(const QList<QImage> &images) {
+    {
+        // 转换可能较慢，不持有写锁
+        auto compact = compactImages(images);
+        QWriteLocker locker(&m_lock);
+        m_images = compact;
+    }
+    emit reset();
+}
+
+bool QImagesMemoryProvider::setImage(size_t index, const QImage &image) {
+    {
+        auto compact = isCompactStorage() ? compactImage(image) : image;
+        QWriteLocker locker(&m_lock);
+        if (index >= static_cast<size_t>(m_images.size())) {
+            return false;
+        }
+        m_images[static_cast<int>(index)] = compact;
+    }
+    emit imageChanged(index);
+    return true;
+}
+
+void QImagesMemoryProvider::appendImages(const QList<QImage> &images) {
+    if (images.isEmpty()) {
+        return;
+    }
+
+    size_t newCount = 0;
+    {
+        auto compact = compactImages(images);
+        QWriteLocker locker(&m_lock);
+        m_images.append(compact);
+        newCount = static_cast<size_t>(m_images.size());
+    }
+    emit countChanged(newCount);
+}
+
+QImagesCachedProvider::QImagesCachedProvider(QObject *parent)
+    : QImagesProvider(parent) {
+    m_cache.setMaxCost(64 * 1024);
+}
+
+QImagesCachedProvider::~QImagesCachedProvider() = default;
+
+QImage QImagesCachedProvider::image(size_t index) const {
+    if (index >= count()) {
+        return QImage();
+    }
+
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        if (auto cached = m_cache.object(index)) {
+            return *cached;
+        }
+    }
+
+    // 解码可能较慢，不持有锁，避免阻塞其他线程读取缓存
+    auto image = load(index);
+    if (image.isNull()) {
+        return image;
+    }
+
+    // 以KB为单位计算缓存开销
+    auto cost = static_cast<int>(qMax<qint64>(1, image.sizeInBytes() / 1024));
+    QMutexLocker locker(&m_cacheMutex);
+    m_cache.insert(index, new QImage(image), cost);
+    return image;
+}
+
+qint64 QImagesCachedProvider::memoryUsage() const {
+    QMutexLocker locker(&m_cacheMutex);
+    return static_cast<qint64>(m_cache.totalCost()) * 1024;
+}
+
+int QImagesCachedProvider::cacheLimit() const {
+    QMutexLocker locker(&m_cacheMutex);
+    return static_cast<int>(m_cache.maxCost());
+}
+
+void QImagesCachedProvider::setCacheLimit(int kbytes) {
+    QMutexLocker locker(&m_cacheMutex);
+    m_cache.setMaxCost(qMax(0, kbytes));
+}
+
+void QImagesCachedProvider::clearCache() {
+    QMutexLocker locker(&m_cacheMutex);
+    m_cache.clear();
+}
+
+QImagesDirectoryProvider::QImagesDirectoryProvider(
+    const QString &directory, const QStringList &nameFilters, QObject *parent)
+    : QImagesCachedProvider(parent), m_directory(directory) {
+    auto filters = nameFilters;
+    if (filters.isEmpty()) {
+        const auto formats = QImageReader::supportedImageFormats();
+        for (const auto &format : formats) {
+            filters << QString("*.%1").arg(QString::fromLatin1(format));
+        }
+    }
+
+    QDir dir(directory);
+    if (!dir.exists()) {
+        LOG_ERROR("QImagesDirectoryProvider: directory does not exist");
+        return;
+    }
+
+    m_fileNames = dir.entryList(filters, QDir::Files | QDir::Readable);
+
+    // 按自然顺序排序，保证slice2排在slice10之前
+    QCollator collator;
+    collator.setNumericMode(true);
+    std::sort(m_fileNames.begin(), m_fileNames.end(),
+              [&collator](const QString &a, const QString &b) {
+                  return collator.compare(a, b) < 0;
+              });
+}
+
+QImagesDirectoryProvider::~QImagesDirectoryProvider() = default;
+
+size_t QImagesDirectoryProvider::count() const {
+    return static_cast<size_t>(m_fileNames.size());
+}
+
+QSize QImagesDirectoryProvider::imageSize(size_t index) const {
+    if (index >= count()) {
+        return QSize();
+    }
+    QImageReader reader(fileName(index));
+    auto size = reader.size();
+    // 部分格式的文件头中没有尺寸信息
+    return size.isValid() ? size : image(index).size();
+}
+
+QString QImagesDirectoryProvider::directory() const { return m_directory; }
+
+QString QImagesDirectoryProvider::fileName(size_t index) const {
+    if (index >= count()) {
+        return QString();
+    }
+    return QDir(m_directory).filePath(m_fileNames[static_cast<int>(index)]);
+}
+
+QImage QImagesDirectoryProvider::load(size_t index) const {
+    QImageReader reader(fileName(index));
+    auto image = reader.read();
+    if (image.isNull()) {
+        LOG_ERROR("QImagesDirectoryProvider: failed to decode image");
+    }
+    return image;
+}
+
+QImagesVolumeProvider::QImagesVolumeProvider(const QString &fileName,
+                                             int width, int height,
+                                             qint64 headerSize, QObject *parent)
+    : QImagesCachedProvider(parent), m_file(fileName), m_width(width),
+    m_height(height) {
+    if (width <= 0 || height <= 0 || headerSize < 0) {
+        LOG_ERROR("QImagesVolumeProvider: invalid slice geometry");
+        return;
+    }
+
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        LOG_ERROR("QImagesVolumeProvider: failed to open volume file");
+        return;
+    }
+
+    qint64 sliceBytes = static_cast<qint64>(width) * height * 2;
+    qint64 dataBytes = m_file.size() - headerSize;
+    if (dataBytes < sliceBytes) {
+        LOG_ERROR("QImagesVolumeProvider: volume file is too small");
+        return;
+    }
+
+    auto mapped = m_file.map(0, m_file.size());
+    if (!mapped) {
+        LOG_ERROR("QImagesVolumeProvider: failed to map volume file");
+        return;
+    }
+
+    m_data = mapped + headerSize;
+    m_count = static_cast<size_t>(dataBytes / sliceBytes);
+}
+
+QImagesVolumeProvider::~QImagesVolumeProvider() = default;
+
+bool QImagesVolumeProvider::isValid() const { return m_data != nullptr; }
+
+size_t QImagesVolumeProvider::count() const { return m_count; }
+
+QSize QImagesVolumeProvider::imageSize(size_t index) const {
+    if (!m_data || index >= m_count) {
+        return QSize();
+    }
+    return QSize(m_width, m_height);
+}
+
+int QImagesVolumeProvider::sliceWidth() const { return m_width; }
+
+int QImagesVolumeProvider::sliceHeight() const { return m_height; }
+
+QImage QImagesVolumeProvider::load(size_t index) const {
+    if (!m_data || index >= m_count) {
+        return QImage();
+    }
+
+    QImage image(m_width, m_height, QImage::Format_Grayscale16);
+    auto rowBytes = static_cast<size_t>(m_width) * 2;
+    auto slice = m_data + index * rowBytes * static_cast<size_t>(m_height);
+
+    // QImage每行按4字节对齐，需要逐行拷贝
+    for (int y = 0; y < m_height; y++) {
+        auto src = slice + static_cast<size_t>(y) * rowBytes;
+        auto dst = reinterpret_cast<quint16 *>(image.scanLine(y));
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        memcpy(dst, src, rowBytes);
+#else
+        for (int x = 0; x < m_width; x++) {
+            dst[x] = qFromLittleEndian<quint16>(src + x * 2);
+        }
+#endif
+    }
+    return image;
+}
@@ -0,0 +1,233 @@
+#ifndef QIMAGESPROVIDER_H
+#define QIMAGESPROVIDER_H
+
+#include <QCache>
+#include <QFile>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QSize>
+#include <QReadWriteLock>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief 图像数据源
+ *
+ * QImagesWidget通过数据源按需获取图像，只有可见或被预取的单元才会请求对应的图像。
+ * image()可能在工作线程中被调用，派生类必须保证其线程安全。
+ */
+class QImagesProvider : public QObject
+{
+    Q_OBJECT
+public:
+    explicit QImagesProvider(QObject *parent = nullptr);
+    ~QImagesProvider() override;
+
+    /**
+     * @brief 获取图像总数
+     */
+    virtual size_t count() const = 0;
+
+    /**
+     * @brief 获取指定索引的图像
+     * @param index 图像索引
+     * @return 图像对象，索引无效或读取失败时返回空图像
+     */
+    virtual QImage image(size_t index) const = 0;
+
+    /**
+     * @brief 获取指定索引的图像尺寸
+     * @details 默认读取整张图像，派生类可以只读取文件头等更快的方式实现
+     * @return 图像尺寸，索引无效或读取失败时返回无效尺寸
+     */
+    virtual QSize imageSize(size_t index) const;
+
+    /**
+     * @brief 数据源自身保存的图像数据占用的内存
+     * @details 默认返回0；与调用者共享的数据也计算在内，同一份数据只计算一次
+     * @return 占用（字节）
+     */
+    virtual qint64 memoryUsage() const;
+
+signals:
+    /**
+     * @brief 在末尾追加了图像
+     * @param count 新的图像总数
+     */
+    void countChanged(size_t count);
+
+    /**
+     * @brief 指定索引的图像内容发生变化
+     * @param index 图像索引
+     */
+    void imageChanged(size_t index);
+
+    /**
+     * @brief 整个图像序列被替换
+     */
+    void reset();
+};
+
+/**
+ * @brief 保存在内存中的图像数据源
+ *
+ * QImagesWidget::setImages()等接口默认使用的数据源
+ */
+class QImagesMemoryProvider : public QImagesProvider
+{
+    Q_OBJECT
+public:
+    explicit QImagesMemoryProvider(QObject *parent = nullptr);
+    ~QImagesMemoryProvider() override;
+
+    size_t count() const override;
+    QImage image(size_t index) const override;
+    qint64 memoryUsage() const override;
+
+    bool isCompactStorage() const;
+
+    /**
+     * @brief 设置是否以紧凑格式保存图像
+     * @details 启用后，不透明且所有像素均为灰色的8位通道图像（RGB32、RGB888、
+     *          RGBX8888和灰度调色板的Indexed8）转换为Grayscale8保存，只占原来的1/4到1/3，
+     *          显示结果不变；Grayscale8和Grayscale16保持原样，不会被提升为32位。
+     *          只影响之后设置的图像，image()返回转换后的图像。默认禁用
+     */
+    void setCompactStorage(bool enable);
+
+    /**
+     * @brief 无损地转换为占用最少的格式，规则见setCompactStorage()
+     */
+    static QImage compactImage(const QImage &image);
+
+    void setImages(const QList<QImage> &images);
+    bool setImage(size_t index, const QImage &image);
+    void appendImages(const QList<QImage> &images);
+
+private:
+    QList<QImage> compactImages(const QList<QImage> &images) const;
+
+    mutable QReadWriteLock m_lock;
+    QList<QImage> m_images;
+    bool m_compactStorage = false;
+};
+
+/**
+ * @brief 带有解码缓存的数据源
+ *
+ * 派生类只需实现load()，最近使用的解码结果会保存在容量有限的缓存中
+ */
+class QImagesCachedProvider : public QImagesProvider
+{
+    Q_OBJECT
+public:
+    explicit QImagesCachedProvider(QObject *parent = nullptr);
+    ~QImagesCachedProvider() override;
+
+    QImage image(size_t index) const override;
+
+    /**
+     * @brief 解码缓存的占用
+     */
+    qint64 memoryUsage() const override;
+
+    /**
+     * @brief 获取解码缓存的容量上限
+     * @return 容量上限（KB）
+     */
+    int cacheLimit() const;
+
+    /**
+     * @brief 设置解码缓存的容量上限
+     * @param kbytes 容量上限（KB），设置为0会禁用缓存
+     */
+    void setCacheLimit(int kbytes);
+
+    void clearCache();
+
+protected:
+    /**
+     * @brief 读取指定索引的图像，可能在工作线程中调用
+     */
+    virtual QImage load(size_t index) const = 0;
+
+private:
+    mutable QMutex m_cacheMutex;
+    mutable QCache<size_t, QImage> m_cache;
+};
+
+/**
+ * @brief 从目录中的图像文件按需解码的数据源
+ *
+ * 文件按文件名的自然顺序排序，例如slice2排在slice10之前
+ */
+class QImagesDirectoryProvider : public QImagesCachedProvider
+{
+    Q_OBJECT
+public:
+    /**
+     * @param directory 图像所在目录
+     * @param nameFilters 文件名过滤器，为空时使用QImageReader支持的所有格式
+     */
+    explicit QImagesDirectoryProvider(const QString &directory,
+                                      const QStringList &nameFilters = {},
+                                      QObject *parent = nullptr);
+    ~QImagesDirectoryProvider() override;
+
+    size_t count() const override;
+
+    /**
+     * @brief 只读取文件头获取尺寸，不解码图像
+     */
+    QSize imageSize(size_t index) const override;
+
+    QString directory() const;
+    QString fileName(size_t index) const;
+
+protected:
+    QImage load(size_t index) const override;
+
+private:
+    QString m_directory;
+    QStringList m_fileNames;
+};
+
+/**
+ * @brief 从内存映射的原始体数据文件中读取16位切片的数据源
+ *
+ * 文件由可选的文件头和若干连续的切片组成，每个切片为width * height个
+ * 小端序的无符号16位像素，读取结果为QImage::Format_Grayscale16
+ */
+class QImagesVolumeProvider : public QImagesCachedProvider
+{
+    Q_OBJECT
+public:
+    QImagesVolumeProvider(const QString &fileName, int width, int height,
+                          qint64 headerSize = 0, QObject *parent = nullptr);
+    ~QImagesVolumeProvider() override;
+
+    /**
+     * @brief 文件是否已成功映射
+     */
+    bool isValid() const;
+
+    size_t count() const override;
+    QSize imageSize(size_t index) const override;
+
+    int sliceWidth() const;
+    int sliceHeight() const;
+
+protected:
+    QImage load(size_t index) const override;
+
+private:
+    QFile m_file;
+    const uchar *m_data = nullptr;
+    int m_width = 0;
+    int m_height = 0;
+    size_t m_count = 0;
+};
+
+#endif // QIMAGESPROVIDER_H
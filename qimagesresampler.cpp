@@ -0,0 +1,573 @@
+#include "qimagesresampler.h"
+
+#include <QAtomicInt>
+#include <QMutexLocker>
+#include <QVector>
+#include <QtGlobal>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define QIMAGESRESAMPLER_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(QIMAGESRESAMPLER_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define QIMAGESRESAMPLER_AVX2
+#define QIMAGESRESAMPLER_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(QIMAGESRESAMPLER_SSE2) && defined(_MSC_VER)
+#define QIMAGESRESAMPLER_AVX2
+#define QIMAGESRESAMPLER_TARGET_AVX2
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace {
+
+constexpr double pi = 3.14159265358979323846;
+
+double filterSupport(QImagesResampler::Filter filter) {
+    switch (filter) {
+    case QImagesResampler::Box:
+        return 0.5;
+    case QImagesResampler::Lanczos:
+        return 3.0;
+    default:
+        return 1.0;
+    }
+}
+
+double sinc(double x) {
+    if (x == 0.0) {
+        return 1.0;
+    }
+    x *= pi;
+    return std::sin(x) / x;
+}
+
+double filterWeight(QImagesResampler::Filter filter, double x) {
+    switch (filter) {
+    case QImagesResampler::Box:
+        return (x > -0.5 && x <= 0.5) ? 1.0 : 0.0;
+    case QImagesResampler::Lanczos:
+        return (x > -3.0 && x < 3.0) ? sinc(x) * sinc(x / 3.0) : 0.0;
+    default:
+        x = std::abs(x);
+        return x < 1.0 ? 1.0 - x : 0.0;
+    }
+}
+
+/**
+ * 一个方向上每个输出坐标对应的输入起点、有效抽头数和归一化权重，
+ * 权重按taps个一组存放，不足的部分补零
+ */
+struct Coefficients {
+    int taps = 0;
+    QVector<int> start;
+    QVector<int> count;
+    QVector<float> weights;
+};
+
+Coefficients computeCoefficients(int inSize, int outSize,
+                                 QImagesResampler::Filter filter) {
+    Coefficients coefficients;
+    double scale = static_cast<double>(inSize) / outSize;
+    double filterScale = std::max(scale, 1.0);
+    double support = filterSupport(filter) * filterScale;
+
+    int taps = static_cast<int>(std::ceil(support)) * 2 + 1;
+    coefficients.taps = taps;
+    coefficients.start.resize(outSize);
+    coefficients.count.resize(outSize);
+    coefficients.weights.fill(0.0f, outSize * taps);
+
+    // 缩小时Box按面积平均：输出像素覆盖输入的[center - scale/2, center + scale/2]，
+    // 每个输入像素的权重为它与该区间重叠的长度，边缘只部分覆盖的像素按比例计入
+    bool area = filter == QImagesResampler::Box && scale > 1.0;
+
+    QVector<double> weights(taps);
+    for (int i = 0; i < outSize; i++) {
+        double center = (i + 0.5) * scale;
+        int first = 0;
+        int last = 0;
+        if (area) {
+            first = std::max(static_cast<int>(std::floor(center - support)), 0);
+            last = std::min(static_cast<int>(std::ceil(center + support)), inSize);
+        } else {
+            first = std::max(static_cast<int>(center - support + 0.5), 0);
+            last = std::min(static_cast<int>(center + support + 0.5), inSize);
+        }
+        int count = std::min(last - first, taps);
+
+        double total = 0.0;
+        for (int k = 0; k < count; k++) {
+            if (area) {
+                double left = std::max<double>(first + k, center - support);
+                double right = std::min<double>(first + k + 1, center + support);
+                weights[k] = std::max(right - left, 0.0);
+            } else {
+                weights[k] = filterWeight(filter,
+                                          (first + k - center + 0.5) / filterScale);
+            }
+            total += weights[k];
+        }
+
+        // 退化情况（例如放大时的Box）退回最近邻
+        if (count <= 0 || total == 0.0) {
+            first = std::min(std::max(static_cast<int>(center), 0), inSize - 1);
+            count = 1;
+            weights[0] = 1.0;
+            total = 1.0;
+        }
+
+        coefficients.start[i] = first;
+        coefficients.count[i] = count;
+        for (int k = 0; k < count; k++) {
+            coefficients.weights[i * taps + k] =
+                static_cast<float>(weights[k] / total);
+        }
+    }
+    return coefficients;
+}
+
+template <typename T>
+using Accumulate = void (*)(float *acc, const T *src, float weight, int n);
+
+// acc[i] += weight * src[i]
+template <typename T>
+void accumulateScalar(float *acc, const T *src, float weight, int n) {
+    for (int i = 0; i < n; i++) {
+        acc[i] += weight * static_cast<float>(src[i]);
+    }
+}
+
+#ifdef QIMAGESRESAMPLER_SSE2
+void accumulateSse2U8(float *acc, const uchar *src, float weight, int n) {
+    const __m128 w = _mm_set1_ps(weight);
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i bytes =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+        __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+        __m128 f0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+        __m128 f1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+        __m128 f2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+        __m128 f3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+        _mm_storeu_ps(acc + i,
+                      _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(f0, w)));
+        _mm_storeu_ps(acc + i + 4,
+                      _mm_add_ps(_mm_loadu_ps(acc + i + 4), _mm_mul_ps(f1, w)));
+        _mm_storeu_ps(acc + i + 8,
+                      _mm_add_ps(_mm_loadu_ps(acc + i + 8), _mm_mul_ps(f2, w)));
+        _mm_storeu_ps(acc + i + 12,
+                      _mm_add_ps(_mm_loadu_ps(acc + i + 12), _mm_mul_ps(f3, w)));
+    }
+    accumulateScalar(acc + i, src + i, weight, n - i);
+}
+
+void accumulateSse2U16(float *acc, const quint16 *src, float weight, int n) {
+    const __m128 w = _mm_set1_ps(weight);
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i words =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128 f0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero));
+        __m128 f1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(words, zero));
+        _mm_storeu_ps(acc + i,
+                      _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(f0, w)));
+        _mm_storeu_ps(acc + i + 4,
+                      _mm_add_ps(_mm_loadu_ps(acc + i + 4), _mm_mul_ps(f1, w)));
+    }
+    accumulateScalar(acc + i, src + i, weight, n - i);
+}
+#endif
+
+#ifdef QIMAGESRESAMPLER_AVX2
+QIMAGESRESAMPLER_TARGET_AVX2
+void accumulateAvx2U8(float *acc, const uchar *src, float weight, int n) {
+    const __m256 w = _mm256_set1_ps(weight);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i bytes =
+            _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i));
+        __m256 f = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+        _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i),
+                                                _mm256_mul_ps(f, w)));
+    }
+    for (; i < n; i++) {
+        acc[i] += weight * static_cast<float>(src[i]);
+    }
+}
+
+QIMAGESRESAMPLER_TARGET_AVX2
+void accumulateAvx2U16(float *acc, const quint16 *src, float weight, int n) {
+    const __m256 w = _mm256_set1_ps(weight);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i words =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m256 f = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(words));
+        _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i),
+                                                _mm256_mul_ps(f, w)));
+    }
+    for (; i < n; i++) {
+        acc[i] += weight * static_cast<float>(src[i]);
+    }
+}
+
+bool detectAvx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+/**
+ * 0表示标量实现，16为SSE2，32为AVX2；
+ * 设置环境变量QIMAGESRESAMPLER_NO_SIMD可强制使用标量实现，便于对比。
+ * 支持AVX2时一定支持SSE2，setSimdWidth()可以把宽度限制到16或0
+ */
+int detectSimdWidth() {
+    if (qEnvironmentVariableIsSet("QIMAGESRESAMPLER_NO_SIMD")) {
+        return 0;
+    }
+#ifdef QIMAGESRESAMPLER_AVX2
+    if (detectAvx2()) {
+        return 32;
+    }
+#endif
+#ifdef QIMAGESRESAMPLER_SSE2
+    return 16;
+#else
+    return 0;
+#endif
+}
+
+int detectedSimdWidth() {
+    static const int width = detectSimdWidth();
+    return width;
+}
+
+// setSimdWidth()设置的上限，实际宽度不超过检测到的宽度
+QAtomicInt simdWidthLimit(32);
+
+int cachedSimdWidth() {
+    return std::min(detectedSimdWidth(), simdWidthLimit.loadAcquire());
+}
+
+template <typename T> Accumulate<T> selectAccumulate();
+
+template <> Accumulate<uchar> selectAccumulate<uchar>() {
+    switch (cachedSimdWidth()) {
+#ifdef QIMAGESRESAMPLER_AVX2
+    case 32:
+        return accumulateAvx2U8;
+#endif
+#ifdef QIMAGESRESAMPLER_SSE2
+    case 16:
+        return accumulateSse2U8;
+#endif
+    default:
+        return accumulateScalar<uchar>;
+    }
+}
+
+template <> Accumulate<quint16> selectAccumulate<quint16>() {
+    switch (cachedSimdWidth()) {
+#ifdef QIMAGESRESAMPLER_AVX2
+    case 32:
+        return accumulateAvx2U16;
+#endif
+#ifdef QIMAGESRESAMPLER_SSE2
+    case 16:
+        return accumulateSse2U16;
+#endif
+    default:
+        return accumulateScalar<quint16>;
+    }
+}
+
+template <typename T> T toPixel(float value) {
+    constexpr float maxValue = std::numeric_limits<T>::max();
+    if (value <= 0.0f) {
+        return 0;
+    }
+    if (value >= maxValue) {
+        return std::numeric_limits<T>::max();
+    }
+    return static_cast<T>(value + 0.5f);
+}
+
+// ARGB32在内存中的字节顺序取决于字节序
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+constexpr int alphaChannel = 3;
+#else
+constexpr int alphaChannel = 0;
+#endif
+
+/**
+ * 对纵向累加后的一行做横向卷积并写出
+ */
+template <typename T>
+void horizontalPass(const float *row, const Coefficients &cx, int channels,
+                    bool premultiplied, bool simd, T *out) {
+    int outWidth = static_cast<int>(cx.start.size());
+    for (int x = 0; x < outWidth; x++) {
+        const float *weights = cx.weights.constData() + x * cx.taps;
+        const float *src = row + cx.start[x] * channels;
+        int count = cx.count[x];
+        T *dst = out + x * channels;
+
+#ifdef QIMAGESRESAMPLER_SSE2
+        if (simd && channels == 4) {
+            __m128 sum = _mm_setzero_ps();
+            for (int k = 0; k < count; k++) {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(src + k * 4),
+                                                 _mm_set1_ps(weights[k])));
+            }
+            float values[4];
+            _mm_storeu_ps(values, sum);
+            for (int c = 0; c < 4; c++) {
+                dst[c] = toPixel<T>(values[c]);
+            }
+        } else
+#endif
+        {
+            for (int c = 0; c < channels; c++) {
+                float sum = 0.0f;
+                for (int k = 0; k < count; k++) {
+                    sum += static_cast<float>(src[k * channels + c]) * weights[k];
+                }
+                dst[c] = toPixel<T>(sum);
+            }
+        }
+
+        // Lanczos的负瓣可能使预乘颜色超过alpha
+        if (premultiplied) {
+            for (int c = 0; c < channels; c++) {
+                if (c != alphaChannel) {
+                    dst[c] = std::min(dst[c], dst[alphaChannel]);
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+void resamplePlanes(const QImage &src, QImage &dst, int channels,
+                    bool premultiplied, QImagesResampler::Filter filter) {
+    auto cy = computeCoefficients(src.height(), dst.height(), filter);
+    auto cx = computeCoefficients(src.width(), dst.width(), filter);
+    auto accumulate = selectAccumulate<T>();
+    bool simd = cachedSimdWidth() > 0;
+
+    // 先纵向后横向：纵向累加在连续内存上进行，便于向量化
+    int n = src.width() * channels;
+    QVector<float> row(n);
+    for (int y = 0; y < dst.height(); y++) {
+        std::fill(row.begin(), row.end(), 0.0f);
+        const float *weights = cy.weights.constData() + y * cy.taps;
+        for (int k = 0; k < cy.count[y]; k++) {
+            auto line =
+                reinterpret_cast<const T *>(src.constScanLine(cy.start[y] + k));
+            accumulate(row.data(), line, weights[k], n);
+        }
+        horizontalPass(row.constData(), cx, channels, premultiplied, simd,
+                       reinterpret_cast<T *>(dst.scanLine(y)));
+    }
+}
+
+} // namespace
+
+QImage QImagesResampler::resample(const QImage &image, const QSize &size,
+                                  Filter filter) {
+    if (image.isNull() || size.isEmpty()) {
+        return QImage();
+    }
+    if (image.size() == size) {
+        return image;
+    }
+    filter = resolveFilter(image.size(), size, filter);
+
+    QImage src = image;
+    int channels = 4;
+    bool premultiplied = false;
+    switch (image.format()) {
+    case QImage::Format_Grayscale8:
+    case QImage::Format_Grayscale16:
+        channels = 1;
+        break;
+    case QImage::Format_RGB32:
+        break;
+    case QImage::Format_ARGB32_Premultiplied:
+        premultiplied = true;
+        break;
+    default:
+        // 带alpha的图像必须在预乘空间中滤波
+        if (image.hasAlphaChannel()) {
+            src = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+            premultiplied = true;
+        } else {
+            src = image.convertToFormat(QImage::Format_RGB32);
+        }
+        break;
+    }
+
+    QImage result(size, src.format());
+    if (result.isNull()) {
+        return result;
+    }
+
+    if (src.format() == QImage::Format_Grayscale16) {
+        resamplePlanes<quint16>(src, result, channels, premultiplied, filter);
+    } else {
+        resamplePlanes<uchar>(src, result, channels, premultiplied, filter);
+    }
+    return result;
+}
+
+QImagesResampler::Filter QImagesResampler::resolveFilter(const QSize &from,
+                                                         const QSize &to,
+                                                         Filter filter) {
+    if (filter != Auto) {
+        return filter;
+    }
+    if (to.width() * 2 <= from.width() && to.height() * 2 <= from.height()) {
+        return Box;
+    }
+    return Bilinear;
+}
+
+int QImagesResampler::simdWidth() { return cachedSimdWidth(); }
+
+int QImagesResampler::setSimdWidth(int width) {
+    simdWidthLimit.storeRelease(qMax(0, width));
+    return cachedSimdWidth();
+}
+
+QImagesMipmapCache::QImagesMipmapCache() { m_levels.setMaxCost(64 * 1024); }
+
+QImagesMipmapCache::~QImagesMipmapCache() = default;
+
+QImage QImagesMipmapCache::levelFor(size_t index, const QSize &size,
+                                    const std::function<QImage()> &load) {
+    auto fits = [&size](const QImage &image) {
+        return image.width() >= size.width() && image.height() >= size.height();
+    };
+
+    // 读取原图前记下序号，生成期间图像被remove()或clear()时不再写回
+    QVector<QImage> levels;
+    quint64 serial = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (auto cached = m_levels.object(index)) {
+            levels = *cached;
+        }
+        serial = serialOf(index);
+    }
+
+    // 第一级已经小于目标尺寸，只能使用原图
+    if (!levels.isEmpty() && !fits(levels.first())) {
+        return load();
+    }
+
+    // 已有级别中仍然足够大的最小一级
+    int best = -1;
+    while (best + 1 < levels.size() && fits(levels[best + 1])) {
+        best++;
+    }
+    if (best >= 0 && best + 1 < levels.size()) {
+        return levels[best];
+    }
+
+    QImage current = best >= 0 ? levels[best] : load();
+    if (current.isNull()) {
+        return current;
+    }
+
+    // 逐级减半直到再减半就会小于目标尺寸
+    bool generated = false;
+    while (current.width() / 2 >= size.width() &&
+           current.height() / 2 >= size.height() && current.width() >= 2 &&
+           current.height() >= 2) {
+        current = QImagesResampler::resample(
+            current, QSize(current.width() / 2, current.height() / 2),
+            QImagesResampler::Box);
+        levels.append(current);
+        generated = true;
+    }
+
+    if (generated) {
+        qint64 bytes = 0;
+        for (const auto &level : levels) {
+            bytes += level.sizeInBytes();
+        }
+        // 以KB为单位计算缓存开销
+        auto cost = static_cast<int>(qMax<qint64>(1, bytes / 1024));
+
+        QMutexLocker locker(&m_mutex);
+        if (serialOf(index) != serial) {
+            return current;
+        }
+        auto existing = m_levels.object(index);
+        if (!existing || existing->size() < levels.size()) {
+            m_levels.insert(index, new QVector<QImage>(levels), cost);
+        }
+    }
+    return current;
+}
+
+int QImagesMipmapCache::cacheLimit() const {
+    QMutexLocker locker(&m_mutex);
+    return static_cast<int>(m_levels.maxCost());
+}
+
+void QImagesMipmapCache::setCacheLimit(int kbytes) {
+    QMutexLocker locker(&m_mutex);
+    m_levels.setMaxCost(qMax(0, kbytes));
+}
+
+void QImagesMipmapCache::remove(size_t index) {
+    QMutexLocker locker(&m_mutex);
+    m_levels.remove(index);
+    m_serials.insert(index, ++m_serial);
+}
+
+void QImagesMipmapCache::clear() {
+    QMutexLocker locker(&m_mutex);
+    m_levels.clear();
+    // 清空后所有图像都以同一序号作废，不再需要逐张记录
+    m_serials.clear();
+    m_clearSerial = ++m_serial;
+}
+
+int QImagesMipmapCache::totalCost() const {
+    QMutexLocker locker(&m_mutex);
+    return static_cast<int>(m_levels.totalCost());
+}
+
+quint64 QImagesMipmapCache::serialOf(size_t index) const {
+    return qMax(m_serials.value(index), m_clearSerial);
+}
@@ -0,0 +1,128 @@
+#ifndef QIMAGESRESAMPLER_H
+#define QIMAGESRESAMPLER_H
+
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QSize>
+#include <QVector>
+
+#include <functional>
+
+/**
+ * @brief 图像重采样引擎
+ *
+ * QImagesWidget在平滑缩放时用它代替QImage::scaled。采用可分离的两遍卷积，
+ * 先纵向后横向，纵向累加使用SSE2/AVX2向量化（运行时检测AVX2），
+ * 不支持时退回标量实现。各实现的运算顺序相同，结果逐字节一致
+ * （见tests/tst_qimagesresampler.cpp）。
+ *
+ * 支持Grayscale8、Grayscale16、RGB32和ARGB32_Premultiplied，其他格式先转换为
+ * RGB32或ARGB32_Premultiplied；Grayscale16保持16位精度。
+ *
+ * 缩小时Box为精确的面积平均，每个输入像素按落在输出像素范围内的面积加权；
+ * 对平缓变化的灰度图像与QImage::scaled(Qt::SmoothTransformation)相差不超过
+ * ±2个灰度级（见tests/tst_qimagesresampler.cpp）。Lanczos的负瓣会使边缘更锐利，
+ * 与Qt的结果存在差异。
+ */
+class QImagesResampler
+{
+public:
+    enum Filter {
+        Auto,     ///< 缩小到1/2及以下时使用Box，否则使用Bilinear
+        Box,      ///< 面积平均，适合大比例缩小
+        Bilinear, ///< 三角形滤波
+        Lanczos   ///< Lanczos3，更锐利但更慢
+    };
+
+    /**
+     * @brief 将图像重采样到指定尺寸
+     * @param image 原图
+     * @param size 目标尺寸，不保持宽高比
+     * @param filter 滤波器
+     * @return 重采样结果，原图为空或尺寸无效时返回空图像
+     */
+    static QImage resample(const QImage &image, const QSize &size,
+                           Filter filter = Auto);
+
+    /**
+     * @brief 根据缩放比例选择实际使用的滤波器
+     */
+    static Filter resolveFilter(const QSize &from, const QSize &to,
+                                Filter filter);
+
+    /**
+     * @brief 是否正在使用SIMD内核
+     * @return 0表示标量实现，否则为向量宽度（字节）
+     */
+    static int simdWidth();
+
+    /**
+     * @brief 限制使用的向量宽度，用于对比各实现的结果和排查问题
+     * @details 对之后开始的重采样生效，默认不限制
+     * @param width 0为标量实现，16最多使用SSE2，32允许AVX2
+     * @return 实际使用的宽度，不超过CPU支持的宽度
+     */
+    static int setSimdWidth(int width);
+};
+
+/**
+ * @brief 每张图像的多级缩小金字塔（1/2、1/4…）
+ *
+ * 缩放时从尺寸不小于目标的最小一级出发，缩放开销取决于输出尺寸而不是原图尺寸。
+ * 各级按需生成并保存在容量有限的缓存中，可在工作线程中使用。
+ */
+class QImagesMipmapCache
+{
+public:
+    QImagesMipmapCache();
+    ~QImagesMipmapCache();
+
+    /**
+     * @brief 获取适合缩放到指定尺寸的图像
+     * @details 返回宽高都不小于size的最小一级，缺少的级别会从已有的最小一级
+     *          （或原图）逐级减半生成；没有合适的级别时返回原图。
+     *          生成期间该图像被remove()或clear()时，结果照常返回但不写入缓存
+     * @param index 图像索引
+     * @param size 目标尺寸
+     * @param load 读取原图，只在需要时调用
+     */
+    QImage levelFor(size_t index, const QSize &size,
+                    const std::function<QImage()> &load);
+
+    /**
+     * @brief 获取缓存的容量上限
+     * @return 容量上限（KB）
+     */
+    int cacheLimit() const;
+    void setCacheLimit(int kbytes);
+
+    /**
+     * @brief 丢弃指定图像的各级缩小结果，正在生成的旧结果也不会再写入
+     */
+    void remove(size_t index);
+    void clear();
+
+    /**
+     * @brief 当前缓存占用
+     * @return 占用（KB）
+     */
+    int totalCost() const;
+
+private:
+    /**
+     * @brief 图像最近一次被作废时的序号，调用者需持有m_mutex
+     */
+    quint64 serialOf(size_t index) const;
+
+    mutable QMutex m_mutex;
+    QCache<size_t, QVector<QImage>> m_levels;
+
+    // 每次remove()或clear()递增，只记录被单独作废过的图像
+    quint64 m_serial = 0;
+    quint64 m_clearSerial = 0;
+    QHash<size_t, quint64> m_serials;
+};
+
+#endif // QIMAGESRESAMPLER_H
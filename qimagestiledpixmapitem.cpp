@@ -0,0 +1,243 @@
+#include "qimagestiledpixmapitem.h"
+#include "qimagesprofiler.h"
+#include "qimagesresampler.h"
+
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+#include <cmath>
+
+namespace {
+
+// 保留供重用的完整分块数，超出的直接释放
+constexpr int maxFreeTiles = 16;
+
+} // namespace
+
+QImagesTiledPixmapItem::QImagesTiledPixmapItem(QGraphicsItem *parent)
+    : QGraphicsItem(parent) {
+    // 需要exposedRect确定可见的分块
+    setFlag(ItemUsesExtendedStyleOption);
+}
+
+QImagesTiledPixmapItem::~QImagesTiledPixmapItem() = default;
+
+QImage QImagesTiledPixmapItem::image() const { return m_image; }
+
+void QImagesTiledPixmapItem::setImage(const QImage &image) {
+    prepareGeometryChange();
+    m_image = image;
+    clearTiles();
+}
+
+int QImagesTiledPixmapItem::tileSize() const { return m_tileSize; }
+
+void QImagesTiledPixmapItem::setTileSize(int pixels) {
+    pixels = qMax(64, pixels);
+    if (m_tileSize == pixels) {
+        return;
+    }
+    m_tileSize = pixels;
+    clearTiles();
+}
+
+int QImagesTiledPixmapItem::cacheLimit() const { return m_cacheLimit; }
+
+void QImagesTiledPixmapItem::setCacheLimit(int kbytes) {
+    m_cacheLimit = qMax(0, kbytes);
+    // 上一次绘制的分块也允许淘汰
+    m_paintCount++;
+    evictTiles();
+}
+
+Qt::TransformationMode QImagesTiledPixmapItem::transformationMode() const {
+    return m_mode;
+}
+
+void QImagesTiledPixmapItem::setTransformationMode(
+    Qt::TransformationMode mode) {
+    if (m_mode == mode) {
+        return;
+    }
+    m_mode = mode;
+    clearTiles();
+}
+
+int QImagesTiledPixmapItem::levelCount() const {
+    if (m_image.isNull()) {
+        return 0;
+    }
+    // 逐级减半，直到一个分块能容纳整张图像
+    int count = 1;
+    int width = m_image.width();
+    int height = m_image.height();
+    while (qMax(width, height) > m_tileSize) {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+        count++;
+    }
+    return count;
+}
+
+int QImagesTiledPixmapItem::tileCount() const {
+    return static_cast<int>(m_tiles.size());
+}
+
+int QImagesTiledPixmapItem::cacheCost() const { return m_cacheCost; }
+
+void QImagesTiledPixmapItem::clearTiles() {
+    m_tiles.clear();
+    m_freeTiles.clear();
+    m_cacheCost = 0;
+    m_levels.clear();
+    m_levels.resize(levelCount());
+    if (!m_levels.isEmpty()) {
+        m_levels[0] = m_image;
+    }
+    update();
+}
+
+int QImagesTiledPixmapItem::type() const { return Type; }
+
+QRectF QImagesTiledPixmapItem::boundingRect() const {
+    return QRectF(QPointF(0, 0), QSizeF(m_image.size()));
+}
+
+void QImagesTiledPixmapItem::paint(QPainter *painter,
+                                   const QStyleOptionGraphicsItem *option,
+                                   QWidget *widget) {
+    Q_UNUSED(widget);
+    if (m_image.isNull()) {
+        return;
+    }
+    auto exposed = option->exposedRect.intersected(boundingRect());
+    if (exposed.isEmpty()) {
+        return;
+    }
+    QIMAGES_PROFILE_SCOPE(Render);
+    m_paintCount++;
+
+    // 选择分辨率不低于屏幕像素的最小一级
+    double lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+        painter->worldTransform());
+    int levelIndex = 0;
+    if (lod > 0 && lod < 1) {
+        levelIndex = qMin(static_cast<int>(m_levels.size()) - 1,
+                          static_cast<int>(std::floor(std::log2(1.0 / lod))));
+    }
+    const auto &image = level(levelIndex);
+    double sx = static_cast<double>(m_image.width()) / image.width();
+    double sy = static_cast<double>(m_image.height()) / image.height();
+
+    int firstColumn = static_cast<int>(exposed.left() / sx) / m_tileSize;
+    int firstRow = static_cast<int>(exposed.top() / sy) / m_tileSize;
+    int lastColumn =
+        qMin((image.width() - 1) / m_tileSize,
+             static_cast<int>(std::ceil(exposed.right() / sx)) / m_tileSize);
+    int lastRow =
+        qMin((image.height() - 1) / m_tileSize,
+             static_cast<int>(std::ceil(exposed.bottom() / sy)) / m_tileSize);
+
+    painter->setRenderHint(QPainter::SmoothPixmapTransform,
+                           m_mode == Qt::SmoothTransformation);
+    for (int row = firstRow; row <= lastRow; row++) {
+        for (int column = firstColumn; column <= lastColumn; column++) {
+            auto pixmap = tile(levelIndex, column, row);
+            QRectF target(column * m_tileSize * sx, row * m_tileSize * sy,
+                          pixmap.width() * sx, pixmap.height() * sy);
+            painter->drawPixmap(target, pixmap, QRectF(pixmap.rect()));
+        }
+    }
+
+    evictTiles();
+}
+
+const QImage &QImagesTiledPixmapItem::level(int index) {
+    if (!m_levels[index].isNull()) {
+        return m_levels[index];
+    }
+
+    // 从已有的最近一级较高分辨率生成，只读取一遍原图
+    int source = index - 1;
+    while (m_levels[source].isNull()) {
+        source--;
+    }
+    int divisor = 1 << index;
+    QSize size((m_image.width() + divisor - 1) / divisor,
+               (m_image.height() + divisor - 1) / divisor);
+
+    QIMAGES_PROFILE_SCOPE(ScaleImage);
+    QIMAGES_PROFILE_COUNT(ImagesScaled, 1);
+    if (m_mode == Qt::FastTransformation) {
+        m_levels[index] =
+            m_levels[source].scaled(size, Qt::IgnoreAspectRatio, m_mode);
+    } else {
+        m_levels[index] = QImagesResampler::resample(m_levels[source], size,
+                                                     QImagesResampler::Box);
+    }
+    return m_levels[index];
+}
+
+QPixmap QImagesTiledPixmapItem::tile(int levelIndex, int column, int row) {
+    auto key = tileKey(levelIndex, column, row);
+    auto it = m_tiles.find(key);
+    if (it == m_tiles.end()) {
+        const auto &image = level(levelIndex);
+        QRect rect(column * m_tileSize, row * m_tileSize, m_tileSize,
+                   m_tileSize);
+        Tile tile;
+        tile.pixmap = createTile(image, rect.intersected(image.rect()));
+        m_cacheCost += tileCost(tile.pixmap);
+        it = m_tiles.insert(key, tile);
+    }
+    it->lastUsed = m_paintCount;
+    return it->pixmap;
+}
+
+QPixmap QImagesTiledPixmapItem::createTile(const QImage &level,
+                                           const QRect &rect) {
+    QIMAGES_PROFILE_SCOPE(PixmapUpload);
+    // 完整分块重用已淘汰的像素图，直接从该级图像绘制，不复制也不重新分配
+    if (rect.size() == QSize(m_tileSize, m_tileSize) &&
+        !m_freeTiles.isEmpty()) {
+        auto pixmap = m_freeTiles.takeLast();
+        QPainter painter(&pixmap);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.drawImage(QPoint(0, 0), level, rect);
+        return pixmap;
+    }
+    QIMAGES_PROFILE_COUNT(PixmapsCreated, 1);
+    return QPixmap::fromImage(level.copy(rect));
+}
+
+void QImagesTiledPixmapItem::evictTiles() {
+    while (m_cacheCost > m_cacheLimit) {
+        // 淘汰最久未使用的分块，本次绘制用到的分块除外
+        auto oldest = m_tiles.end();
+        for (auto it = m_tiles.begin(); it != m_tiles.end(); ++it) {
+            if (it->lastUsed < m_paintCount &&
+                (oldest == m_tiles.end() || it->lastUsed < oldest->lastUsed)) {
+                oldest = it;
+            }
+        }
+        if (oldest == m_tiles.end()) {
+            break;
+        }
+
+        m_cacheCost -= tileCost(oldest->pixmap);
+        if (oldest->pixmap.size() == QSize(m_tileSize, m_tileSize) &&
+            m_freeTiles.size() < maxFreeTiles) {
+            m_freeTiles.append(oldest->pixmap);
+        }
+        m_tiles.erase(oldest);
+    }
+}
+
+quint64 QImagesTiledPixmapItem::tileKey(int levelIndex, int column, int row) {
+    return (static_cast<quint64>(levelIndex) << 48) |
+           (static_cast<quint64>(row) << 24) | static_cast<quint64>(column);
+}
+
+int QImagesTiledPixmapItem::tileCost(const QPixmap &pixmap) {
+    return qMax(1, pixmap.width() * pixmap.height() * pixmap.depth() / 8 / 1024);
+}
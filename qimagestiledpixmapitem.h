@@ -0,0 +1,112 @@
+#ifndef QIMAGESTILEDPIXMAPITEM_H
+#define QIMAGESTILEDPIXMAPITEM_H
+
+#include <QGraphicsItem>
+#include <QHash>
+#include <QImage>
+#include <QPixmap>
+#include <QRectF>
+#include <QVector>
+
+/**
+ * @brief 分块、多级分辨率显示超大图像的图形项
+ *
+ * 原图保存在内存中，不会整体转换为QPixmap。绘制时根据当前的缩放比例选择
+ * 分辨率合适的一级（原图、1/2、1/4…），只为可见区域覆盖的分块生成像素图。
+ * 分块像素图的总占用不超过cacheLimit()，淘汰最久未使用的分块，
+ * 被淘汰的完整分块会被重用，不必重新分配。
+ *
+ * 图形项坐标以原图像素为单位，boundingRect()为(0, 0, 宽, 高)。
+ * 缩小的各级在首次需要时生成，只在GUI线程中使用。
+ */
+class QImagesTiledPixmapItem : public QGraphicsItem
+{
+public:
+    enum { Type = UserType + 1 };
+
+    explicit QImagesTiledPixmapItem(QGraphicsItem *parent = nullptr);
+    ~QImagesTiledPixmapItem() override;
+
+    QImage image() const;
+
+    /**
+     * @brief 设置要显示的图像，丢弃已生成的各级和分块
+     * @details 图像为隐式共享，不会复制像素数据
+     */
+    void setImage(const QImage &image);
+
+    int tileSize() const;
+
+    /**
+     * @brief 设置分块的边长
+     * @param pixels 边长（像素），最小为64，默认为256
+     */
+    void setTileSize(int pixels);
+
+    /**
+     * @brief 获取分块像素图的容量上限
+     * @return 容量上限（KB）
+     */
+    int cacheLimit() const;
+
+    /**
+     * @brief 设置分块像素图的容量上限，默认为65536（64 MB）
+     * @details 当前一次绘制用到的分块不会被淘汰，可见区域需要的分块超出上限时暂时超出
+     */
+    void setCacheLimit(int kbytes);
+
+    Qt::TransformationMode transformationMode() const;
+    void setTransformationMode(Qt::TransformationMode mode);
+
+    /**
+     * @brief 分辨率级数，包括原图
+     */
+    int levelCount() const;
+
+    /**
+     * @brief 当前保存的分块数
+     */
+    int tileCount() const;
+
+    /**
+     * @brief 当前分块像素图的占用
+     * @return 占用（KB）
+     */
+    int cacheCost() const;
+
+    /**
+     * @brief 丢弃所有分块像素图和缩小的各级，下次绘制时重新生成
+     */
+    void clearTiles();
+
+    int type() const override;
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+               QWidget *widget = nullptr) override;
+
+private:
+    struct Tile {
+        QPixmap pixmap;
+        quint64 lastUsed = 0;
+    };
+
+    const QImage &level(int index);
+    QPixmap tile(int levelIndex, int column, int row);
+    QPixmap createTile(const QImage &level, const QRect &rect);
+    void evictTiles();
+
+    static quint64 tileKey(int levelIndex, int column, int row);
+    static int tileCost(const QPixmap &pixmap);
+
+    QImage m_image;
+    QVector<QImage> m_levels;
+    QHash<quint64, Tile> m_tiles;
+    QVector<QPixmap> m_freeTiles;
+    int m_tileSize = 256;
+    int m_cacheLimit = 64 * 1024;
+    int m_cacheCost = 0;
+    quint64 m_paintCount = 0;
+    Qt::TransformationMode m_mode = Qt::SmoothTransformation;
+};
+
+#endif // QIMAGESTILEDPIXMAPITEM_H
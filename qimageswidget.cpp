@@ -1,8 +1,10 @@
 #include "qimageswidget.h"
+#include "qimagesprofiler.h"
 #include "utils.h"
 
 #include <QAction>
 #include <QContextMenuEvent>
+#include <QDir>
 #include <QFileDialog>
 #include <QGraphicsPixmapItem>
 #include <QGraphicsScene>
@@ -10,11 +12,38 @@
 #include <QMenu>
 #include <QMessageBox>
 #include <QMouseEvent>
+#include <QPaintEvent>
 #include <QPainter>
 #include <QScrollArea>
+#include <QScrollBar>
+#include <QThread>
 #include <QVBoxLayout>
+#include <QWheelEvent>
 #include <qgraphicsitem.h>
 
+#include <cmath>
+
+namespace {
+
+QPixmap uploadPixmap(const QImage &image) {
+    QIMAGES_PROFILE_SCOPE(PixmapUpload);
+    QIMAGES_PROFILE_COUNT(PixmapsCreated, 1);
+    return QPixmap::fromImage(image);
+}
+
+qint64 pixmapBytes(const QPixmap &pixmap) {
+    return static_cast<qint64>(pixmap.width()) * pixmap.height() *
+           pixmap.depth() / 8;
+}
+
+// 预取任务的状态，只有仍在排队的任务可以被撤销
+enum PrefetchState { PrefetchQueued, PrefetchRunning, PrefetchDropped };
+
+// 拼图时每次缩放的最大边长（输出像素），放大很多倍时中间结果不超过这么大
+constexpr int pageTileSide = 1024;
+
+} // namespace
+
 QImagesWidgetItemView::QImagesWidgetItemView(QWidget *parent)
     : QGraphicsView(parent), m_scene(this) {
     setScene(&m_scene);
@@ -28,33 +57,233 @@ QImagesWidgetItemView::QImagesWidgetItemView(QWidget *parent)
 QImagesWidgetItemView::~QImagesWidgetItemView() = default;
 
 QGraphicsPixmapItem *QImagesWidgetItemView::setImage(const QImage &image) {
-    m_image = image;
-    m_scene.clear();
-
     if (image.isNull()) {
+        setPixmap(QPixmap());
         LOG_ERROR("setImage: image is null");
         return nullptr;
     }
 
-    QPixmap pixmap = QPixmap::fromImage(image);
-    auto item = m_scene.addPixmap(pixmap);
-    item->setPos(-m_scene.width() / 2, -m_scene.height() / 2);
-    return item;
+    return setPixmap(uploadPixmap(image));
+}
+
+QGraphicsPixmapItem *QImagesWidgetItemView::setPixmap(const QPixmap &pixmap) {
+    QIMAGES_PROFILE_SCOPE(SetPixmap);
+    m_pixmap = pixmap;
+    clearScene();
+
+    if (!pixmap.isNull()) {
+        m_pixmapItem = m_scene.addPixmap(pixmap);
+        placePixmapItem();
+    }
+    restoreOverlayItem();
+    return m_pixmapItem;
+}
+
+QGraphicsPixmapItem *
+QImagesWidgetItemView::updatePixmap(const QPixmap &pixmap) {
+    if (!m_pixmapItem || pixmap.isNull()) {
+        return setPixmap(pixmap);
+    }
+
+    // 原位替换像素图，保留场景中的其他图形项
+    QIMAGES_PROFILE_SCOPE(SetPixmap);
+    m_pixmap = pixmap;
+    m_pixmapItem->setPixmap(pixmap);
+    placePixmapItem();
+    return m_pixmapItem;
+}
+
+QImagesTiledPixmapItem *
+QImagesWidgetItemView::setTiledImage(const QImage &image) {
+    m_pixmap = QPixmap();
+    clearScene();
+
+    if (!image.isNull()) {
+        m_tiledItem = new QImagesTiledPixmapItem;
+        m_tiledItem->setImage(image);
+        m_scene.addItem(m_tiledItem);
+        placePixmapItem();
+    }
+    restoreOverlayItem();
+    return m_tiledItem;
+}
+
+QPixmap QImagesWidgetItemView::pixmap() const { return m_pixmap; }
+
+QSizeF QImagesWidgetItemView::sceneSize() const { return m_sceneSize; }
+
+void QImagesWidgetItemView::setSceneSize(const QSizeF &size) {
+    if (m_sceneSize == size) {
+        return;
+    }
+    m_sceneSize = size;
+    if (imageItem()) {
+        placePixmapItem();
+    }
+    updateSceneRect();
 }
 
 QPair<double, double> QImagesWidgetItemView::sceneOffset() const {
-    auto sceneRect = m_scene.sceneRect();
-    return qMakePair(sceneRect.x(), sceneRect.y());
+    // 内部保存相对于图像居中位置的偏移，对外仍为场景矩形的左上角
+    return qMakePair(m_sceneOffset.first - m_sceneSize.width() / 2,
+                     m_sceneOffset.second - m_sceneSize.height() / 2);
 }
 
 void QImagesWidgetItemView::setSceneOffset(double hOffset, double vOffset) {
-    m_scene.setSceneRect(hOffset, vOffset, m_scene.width(), m_scene.height());
+    auto offset = qMakePair(hOffset + m_sceneSize.width() / 2,
+                            vOffset + m_sceneSize.height() / 2);
+    if (m_sceneOffset == offset) {
+        return;
+    }
+    m_sceneOffset = offset;
+    updateSceneRect();
+}
+
+void QImagesWidgetItemView::updateSceneRect() {
+    // 缩放时可见区域缩小为场景尺寸的1/zoom，再由视图变换放大到原来的尺寸
+    QSizeF visible = m_sceneSize / m_zoom;
+    QRectF rect(QPointF(m_sceneOffset.first + m_pan.x() - visible.width() / 2,
+                        m_sceneOffset.second + m_pan.y() - visible.height() / 2),
+                visible);
+    m_scene.setSceneRect(rect);
+    setSceneRect(rect);
+    setTransform(QTransform::fromScale(m_zoom, m_zoom));
+}
+
+void QImagesWidgetItemView::placePixmapItem() {
+    auto item = imageItem();
+    item->setPos(-m_sceneSize.width() / 2, -m_sceneSize.height() / 2);
+
+    // 放大时像素图以更高的分辨率生成，分块图像按原图分辨率保存，都缩回场景尺寸显示
+    auto size = m_tiledItem ? m_tiledItem->image().size() : m_pixmap.size();
+    QTransform transform;
+    if (!size.isEmpty() && !m_sceneSize.isEmpty() &&
+        size != m_sceneSize.toSize()) {
+        transform.scale(m_sceneSize.width() / size.width(),
+                        m_sceneSize.height() / size.height());
+        if (m_pixmapItem) {
+            m_pixmapItem->setTransformationMode(Qt::SmoothTransformation);
+        }
+    }
+    item->setTransform(transform);
+}
+
+QGraphicsItem *QImagesWidgetItemView::imageItem() const {
+    if (m_pixmapItem) {
+        return m_pixmapItem;
+    }
+    return m_tiledItem;
+}
+
+bool QImagesWidgetItemView::hasImage() const { return imageItem() != nullptr; }
+
+void QImagesWidgetItemView::clearScene() {
+    m_pixmapItem = nullptr;
+    m_tiledItem = nullptr;
+    m_sourceImage = nullptr;
+    if (m_overlayItem) {
+        m_scene.removeItem(m_overlayItem);
+    }
+    m_scene.clear();
+}
+
+void QImagesWidgetItemView::restoreOverlayItem() {
+    if (m_overlayItem) {
+        m_scene.addItem(m_overlayItem);
+    }
+}
+
+QImagesOverlayItem *QImagesWidgetItemView::overlayItem() {
+    if (!m_overlayItem) {
+        // 由场景拥有，清空场景前会先移出
+        m_overlayItem = new QImagesOverlayItem;
+        m_scene.addItem(m_overlayItem);
+    }
+    return m_overlayItem;
+}
+
+bool QImagesWidgetItemView::isNavigationEnabled() const {
+    return m_navigationEnabled;
+}
+
+void QImagesWidgetItemView::setNavigationEnabled(bool enable) {
+    m_navigationEnabled = enable;
+    m_dragging = false;
+}
+
+double QImagesWidgetItemView::zoom() const { return m_zoom; }
+
+QPointF QImagesWidgetItemView::pan() const { return m_pan; }
+
+void QImagesWidgetItemView::setViewTransform(double zoom, const QPointF &pan) {
+    if (zoom <= 0 || (qFuzzyCompare(m_zoom, zoom) && m_pan == pan)) {
+        return;
+    }
+    m_zoom = zoom;
+    m_pan = pan;
+    updateSceneRect();
+}
+
+void QImagesWidgetItemView::wheelEvent(QWheelEvent *event) {
+    if (!m_navigationEnabled) {
+        QGraphicsView::wheelEvent(event);
+        return;
+    }
+
+    // 每一格滚轮（120）缩放约1.2倍
+    double factor = std::pow(1.2, event->angleDelta().y() / 120.0);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    auto position = event->position().toPoint();
+#else
+    auto position = event->pos();
+#endif
+    auto anchor = mapToScene(position) - sceneRect().center();
+    emit zoomRequested(factor, anchor);
+    event->accept();
+}
+
+void QImagesWidgetItemView::mousePressEvent(QMouseEvent *event) {
+    auto item = itemAt(event->pos());
+    if (m_navigationEnabled && event->button() == Qt::LeftButton &&
+        (!item || item == imageItem() || item == m_overlayItem)) {
+        m_dragging = true;
+        m_lastDragPos = event->pos();
+        event->accept();
+        return;
+    }
+    QGraphicsView::mousePressEvent(event);
+}
+
+void QImagesWidgetItemView::mouseMoveEvent(QMouseEvent *event) {
+    if (m_dragging) {
+        // 拖动方向与可见区域中心的移动方向相反
+        QPointF delta = QPointF(event->pos() - m_lastDragPos) / m_zoom;
+        m_lastDragPos = event->pos();
+        emit panRequested(-delta);
+        event->accept();
+        return;
+    }
+    QGraphicsView::mouseMoveEvent(event);
+}
+
+void QImagesWidgetItemView::mouseReleaseEvent(QMouseEvent *event) {
+    if (m_dragging && event->button() == Qt::LeftButton) {
+        m_dragging = false;
+        event->accept();
+        return;
+    }
+    QGraphicsView::mouseReleaseEvent(event);
 }
 
 void QImagesWidgetItemView::contextMenuEvent(QContextMenuEvent *event) {
-    if (m_image.isNull()) {
+    if (!showContextMenu(event->globalPos())) {
         QGraphicsView::contextMenuEvent(event);
-        return;
+    }
+}
+
+bool QImagesWidgetItemView::showContextMenu(const QPoint &globalPos) {
+    if (!hasImage()) {
+        return false;
     }
 
     QMenu contextMenu(this);
@@ -73,7 +302,7 @@ void QImagesWidgetItemView::contextMenuEvent(QContextMenuEvent *event) {
     QAction *copyWithObjectsAction =
         copyMenu->addAction(tr("Copy with Graphics Objects"));
 
-    QAction *selectedAction = contextMenu.exec(event->globalPos());
+    QAction *selectedAction = contextMenu.exec(globalPos);
 
     if (selectedAction == saveImageOnlyAction) {
         saveImage(false);
@@ -84,79 +313,158 @@ void QImagesWidgetItemView::contextMenuEvent(QContextMenuEvent *event) {
     } else if (selectedAction == copyWithObjectsAction) {
         copyImage(true);
     }
+    return true;
 }
 
-void QImagesWidgetItemView::saveImage(bool withObjects) {
-    if (m_image.isNull()) {
-        return;
+/**
+ * @brief 单元视图的容器
+ *
+ * WidgetBackend下单元视图作为子控件摆放在其中；BatchedBackend下视图隐藏，
+ * 由它在一次绘制中渲染所有单元的场景
+ */
+class QImagesWidgetCanvas : public QWidget
+{
+public:
+    QImagesWidgetCanvas(QImagesWidget *owner, QWidget *parent)
+        : QWidget(parent), m_owner(owner) {
+        // BatchedBackend下的悬停信号需要没有按键时的移动事件
+        setMouseTracking(true);
     }
 
-    QString fileName = QFileDialog::getSaveFileName(
-        this, tr("Save Image"), QString("image.png"),
-        tr("Image Files (*.png *.jpg *.jpeg *.bmp *.tiff)"));
+    void scheduleRepaint() { update(); }
+
+protected:
+    void paintEvent(QPaintEvent *event) override {
+        if (m_owner->m_renderBackend != QImagesWidget::BatchedBackend) {
+            return;
+        }
+        QPainter painter(this);
+        m_owner->paintCells(painter, event->rect());
+    }
 
-    if (!fileName.isEmpty()) {
-        QImage imageToSave;
+    void contextMenuEvent(QContextMenuEvent *event) override {
+        auto cell = m_owner->cellAtPos(event->pos());
+        if (!cell || !cell->view->showContextMenu(event->globalPos())) {
+            QWidget::contextMenuEvent(event);
+        }
+    }
 
-        if (withObjects) {
-            // 渲染整个场景（包含图形对象）
-            QRectF sceneRect = m_scene.sceneRect();
-            if (sceneRect.isEmpty()) {
-                sceneRect = m_scene.itemsBoundingRect();
-            }
+    // 视图隐藏时由画布处理联动导航的滚轮和拖动
+    void wheelEvent(QWheelEvent *event) override {
+        if (!isNavigating()) {
+            QWidget::wheelEvent(event);
+            return;
+        }
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+        auto position = event->position().toPoint();
+#else
+        auto position = event->pos();
+#endif
+        auto cell = m_owner->cellAtPos(position);
+        if (!cell) {
+            QWidget::wheelEvent(event);
+            return;
+        }
+        auto center = QRectF(cell->view->geometry()).center();
+        m_owner->onZoomRequested(std::pow(1.2, event->angleDelta().y() / 120.0),
+                                 (QPointF(position) - center) / m_owner->m_zoom);
+        event->accept();
+    }
 
-            imageToSave = QImage(sceneRect.size().toSize(), QImage::Format_ARGB32);
-            imageToSave.fill(Qt::transparent);
+    void mousePressEvent(QMouseEvent *event) override {
+        if (isNavigating() && event->button() == Qt::LeftButton) {
+            m_dragging = true;
+            m_lastDragPos = event->pos();
+            event->accept();
+            return;
+        }
+        QWidget::mousePressEvent(event);
+    }
 
-            QPainter painter(&imageToSave);
-            painter.setRenderHint(QPainter::Antialiasing);
-            m_scene.render(&painter, QRectF(), sceneRect);
-            painter.end();
-        } else {
-            // 仅保存原图
-            imageToSave = m_image;
+    void mouseMoveEvent(QMouseEvent *event) override {
+        if (m_dragging) {
+            QPointF delta = QPointF(event->pos() - m_lastDragPos) / m_owner->m_zoom;
+            m_lastDragPos = event->pos();
+            m_owner->onPanRequested(-delta);
+            event->accept();
+            return;
         }
+        QWidget::mouseMoveEvent(event);
+    }
 
-        if (imageToSave.save(fileName)) {
-            QString message =
-                withObjects
-                                  ? tr("Image with graphics objects saved to: %1").arg(fileName)
-                                  : tr("Original image saved to: %1").arg(fileName);
-            QMessageBox::information(this, tr("Success"), message);
-        } else {
-            QMessageBox::warning(this, tr("Error"), tr("Failed to save image"));
+    void mouseReleaseEvent(QMouseEvent *event) override {
+        if (m_dragging && event->button() == Qt::LeftButton) {
+            m_dragging = false;
+            event->accept();
+            return;
         }
+        QWidget::mouseReleaseEvent(event);
     }
-}
 
-void QImagesWidgetItemView::copyImage(bool withObjects) {
-    if (m_image.isNull()) {
+private:
+    bool isNavigating() const {
+        return m_owner->m_renderBackend == QImagesWidget::BatchedBackend &&
+               m_owner->m_linkedNavigation;
+    }
+
+    QImagesWidget *m_owner;
+    bool m_dragging = false;
+    QPoint m_lastDragPos;
+};
+
+void QImagesWidgetItemView::saveImage(bool withObjects) {
+    if (!hasImage()) {
         return;
     }
 
-    QClipboard *clipboard = QApplication::clipboard();
-    QImage imageToCopy;
+    QString fileName = QFileDialog::getSaveFileName(
+        this, tr("Save Image"), QString("image.png"),
+        tr("Image Files (*.png *.jpg *.jpeg *.bmp *.tiff)"));
 
-    if (withObjects) {
-        // 渲染整个场景（包含图形对象）
-        QRectF sceneRect = m_scene.sceneRect();
-        if (sceneRect.isEmpty()) {
-            sceneRect = m_scene.itemsBoundingRect();
-        }
+    if (fileName.isEmpty()) {
+        return;
+    }
 
-        imageToCopy = QImage(sceneRect.size().toSize(), QImage::Format_ARGB32);
-        imageToCopy.fill(Qt::transparent);
+    int id = exportImage(fileName, withObjects);
+    if (id < 0) {
+        QMessageBox::warning(this, tr("Error"), tr("Failed to save image"));
+        return;
+    }
 
-        QPainter painter(&imageToCopy);
-        painter.setRenderHint(QPainter::Antialiasing);
-        m_scene.render(&painter, QRectF(), sceneRect);
-        painter.end();
-    } else {
-        // 仅复制原图
-        imageToCopy = m_image;
+    // 编码和写文件在后台完成，导出器报告该任务的结果后与复制图像一样提示
+    auto connection = QSharedPointer<QMetaObject::Connection>::create();
+    *connection = connect(
+        exporter(), &QImagesExporter::finished, this,
+        [this, id, withObjects, connection](int finishedId,
+                                            const QString &savedFileName,
+                                            bool ok, const QString &errorString) {
+            if (finishedId != id) {
+                return;
+            }
+            disconnect(*connection);
+
+            if (ok) {
+                QString message =
+                    withObjects
+                        ? tr("Image with graphics objects saved to: %1")
+                              .arg(savedFileName)
+                        : tr("Original image saved to: %1").arg(savedFileName);
+                QMessageBox::information(this, tr("Success"), message);
+            } else {
+                QMessageBox::warning(this, tr("Error"),
+                                     tr("Failed to save image: %1")
+                                         .arg(errorString));
+            }
+        });
+}
+
+void QImagesWidgetItemView::copyImage(bool withObjects) {
+    if (!hasImage()) {
+        return;
     }
 
-    clipboard->setImage(imageToCopy);
+    QClipboard *clipboard = QApplication::clipboard();
+    clipboard->setImage(grabImage(withObjects));
 
     QString message = withObjects
                           ? tr("Image with graphics objects copied to clipboard")
@@ -164,14 +472,133 @@ void QImagesWidgetItemView::copyImage(bool withObjects) {
     QMessageBox::information(this, tr("Success"), message);
 }
 
+QImage QImagesWidgetItemView::grabImage(bool withObjects) {
+    if (!hasImage()) {
+        return QImage();
+    }
+
+    QImage source;
+    if (m_sourceImage) {
+        source = m_sourceImage();
+    }
+    if (source.isNull()) {
+        source = m_tiledItem ? m_tiledItem->image() : m_pixmap.toImage();
+    }
+
+    // 只有图像时原样返回，不需要渲染场景
+    if (!withObjects || !hasOverlays()) {
+        return source;
+    }
+
+    // 在图像上按其分辨率绘制图形项，不透明图像使用不带alpha的格式
+    auto image = source.convertToFormat(source.hasAlphaChannel()
+                                            ? QImage::Format_ARGB32_Premultiplied
+                                            : QImage::Format_RGB32);
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    renderOverlays(&painter, QRectF(image.rect()),
+                   imageItem()->sceneBoundingRect());
+    painter.end();
+    return image;
+}
+
+void QImagesWidgetItemView::setSourceImage(
+    const std::function<QImage()> &source) {
+    m_sourceImage = source;
+}
+
+bool QImagesWidgetItemView::hasOverlays() const {
+    auto count = m_scene.items().size() - (hasImage() ? 1 : 0);
+    if (m_overlayItem && m_overlayItem->isEmpty()) {
+        count--;
+    }
+    return count > 0;
+}
+
+void QImagesWidgetItemView::renderOverlays(QPainter *painter,
+                                           const QRectF &target,
+                                           const QRectF &source) {
+    if (!hasOverlays()) {
+        return;
+    }
+
+    // 暂时隐藏图像，由调用者以更高的分辨率绘制
+    auto item = imageItem();
+    bool imageVisible = item && item->isVisible();
+    if (imageVisible) {
+        item->hide();
+    }
+    m_scene.render(painter, target, source, Qt::IgnoreAspectRatio);
+    if (imageVisible) {
+        item->show();
+    }
+}
+
+int QImagesWidgetItemView::exportImage(const QString &fileName,
+                                       bool withObjects) {
+    auto image = grabImage(withObjects);
+    if (image.isNull()) {
+        return -1;
+    }
+    return exporter()->save(image, fileName);
+}
+
+QImagesExporter *QImagesWidgetItemView::exporter() {
+    if (!m_exporter) {
+        m_exporter = new QImagesExporter(this);
+    }
+    return m_exporter;
+}
+
+void QImagesWidgetItemView::setExporter(QImagesExporter *exporter) {
+    m_exporter = exporter;
+}
+
 QImagesWidget::QImagesWidget(QWidget *parent)
     : QWidget{parent}, m_viewWidth(256), m_viewHeight(256), m_sceneWidth(0),
-    m_sceneHeight(0), m_scrollArea(nullptr), m_contentWidget(nullptr),
-    m_grid(nullptr) {
+    m_sceneHeight(0), m_scrollArea(nullptr), m_contentWidget(nullptr) {
+    m_pixmapCache.setMaxCost(64 * 1024);
+    m_windowSourceCache.setMaxCost(64 * 1024);
+    m_prefetchPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+    m_memoryProvider = new QImagesMemoryProvider(this);
+    m_exporter = new QImagesExporter(this);
+    m_overlayModel = new QImagesOverlayModel(this);
+    connect(m_overlayModel, &QImagesOverlayModel::changed, this,
+            &QImagesWidget::onOverlayChanged);
+    connect(m_overlayModel, &QImagesOverlayModel::reset, this,
+            &QImagesWidget::onOverlayReset);
+    m_cineTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_cineTimer, &QTimer::timeout, this, &QImagesWidget::onCineTick);
+    m_navigationTimer.setSingleShot(true);
+    m_navigationTimer.setInterval(16);
+    connect(&m_navigationTimer, &QTimer::timeout, this,
+            &QImagesWidget::applyNavigation);
+    m_detailTimer.setSingleShot(true);
+    m_detailTimer.setInterval(200);
+    connect(&m_detailTimer, &QTimer::timeout, this,
+            &QImagesWidget::updateDetailZoom);
+    m_pointerTimer.setSingleShot(true);
+    m_pointerTimer.setInterval(16);
+    connect(&m_pointerTimer, &QTimer::timeout, this,
+            &QImagesWidget::flushPointerSignals);
+    m_cineBuffer.resize(8);
+    updateWindowLut();
     setupLayout();
+    setProvider(m_memoryProvider);
 }
 
-QImagesWidget::~QImagesWidget() {}
+QImagesWidget::~QImagesWidget() {
+    if (m_provider) {
+        disconnect(m_provider, nullptr, this, nullptr);
+    }
+    cancelPrefetch();
+    cancelCineFrames();
+    m_prefetchPool.clear();
+    m_prefetchPool.waitForDone();
+    // 析构期间不再发出信号，接收者可能正在访问已部分析构的控件
+    abortExportAll();
+    m_exportPool.waitForDone();
+}
 
 size_t QImagesWidget::colNum() const { return m_colNum; }
 
@@ -204,8 +631,17 @@ bool QImagesWidget::setPageIndex(size_t index) {
         return false;
     }
 
-    if (m_pageIndex != index) {
+    if (m_continuousScroll) {
+        // 滚动到该页的第一行，页码随视口更新
+        m_scrollArea->verticalScrollBar()->setValue(
+            cellRect(index * m_rowNum, 0).top());
+        return true;
+    }
+
+    if (m_pageIndex != index || m_imageShift != 0) {
         m_pageIndex = index;
+        m_imageShift = 0;
+        // 缓存键不变，新的预取窗口由schedulePrefetch()调整
         updateMarkers();
     }
     return true;
@@ -219,6 +655,10 @@ void QImagesWidget::setViewWidth(size_t newViewWidth) {
     }
     if (m_viewWidth != newViewWidth) {
         m_viewWidth = newViewWidth;
+        if (m_sceneWidth == 0) {
+            // 场景宽度跟随视图宽度，缓存的缩放结果已失效
+            clearPixmapCache();
+        }
 
         updateGrid();
         updateMarkers();
@@ -233,6 +673,10 @@ void QImagesWidget::setViewHeight(size_t newViewHeight) {
     }
     if (m_viewHeight != newViewHeight) {
         m_viewHeight = newViewHeight;
+        if (m_sceneHeight == 0) {
+            // 场景高度跟随视图高度，缓存的缩放结果已失效
+            clearPixmapCache();
+        }
 
         updateGrid();
         updateMarkers();
@@ -250,6 +694,7 @@ void QImagesWidget::setSceneWidth(size_t newSceneWidth) {
     // Set scene width to 0 to re-enable tracking view width
     if (m_sceneWidth != newSceneWidth) {
         m_sceneWidth = newSceneWidth;
+        clearPixmapCache();
         updateGrid();
         updateMarkers();
     }
@@ -266,297 +711,2484 @@ void QImagesWidget::setSceneHeight(size_t newSceneHeight) {
     // Set scene height to 0 to re-enable tracking view height
     if (m_sceneHeight != newSceneHeight) {
         m_sceneHeight = newSceneHeight;
+        clearPixmapCache();
         updateGrid();
         updateMarkers();
     }
 }
 
 void QImagesWidget::setImages(const QList<QImage> &images) {
-    m_images = images;
-    m_pageIndex = 0;
-    updateGrid();
-    updateMarkers();
-}
-
-int QImagesWidget::horizontalSpacing() const {
-    return m_grid->horizontalSpacing();
+    if (m_provider != m_memoryProvider) {
+        setProvider(m_memoryProvider);
+    }
+    // 内存数据源发出reset信号后由resetImages刷新
+    m_memoryProvider->setImages(images);
 }
 
-void QImagesWidget::setHorizontalSpacing(int spacing) {
-    if (m_grid->horizontalSpacing() == spacing || spacing < 0) {
-        return;
+bool QImagesWidget::setImage(size_t index, const QImage &image) {
+    if (m_provider != m_memoryProvider) {
+        LOG_ERROR("setImage: images are supplied by an external provider");
+        return false;
     }
-    m_grid->setHorizontalSpacing(spacing);
-    updateGrid();
-    updateMarkers();
+    // 内存数据源发出imageChanged信号后由invalidate刷新
+    return m_memoryProvider->setImage(index, image);
 }
 
-int QImagesWidget::verticalSpacing() const { return m_grid->verticalSpacing(); }
+QImagesProvider *QImagesWidget::provider() const { return m_provider; }
 
-void QImagesWidget::setVerticalSpacing(int spacing) {
-    if (m_grid->verticalSpacing() == spacing || spacing < 0) {
-        return;
-    }
-    m_grid->setVerticalSpacing(spacing);
-    updateGrid();
-    updateMarkers();
+bool QImagesWidget::isCompactStorageEnabled() const {
+    return m_memoryProvider->isCompactStorage();
 }
 
-bool QImagesWidget::isUpdateEnabled() const { return m_enableUpdate; }
+void QImagesWidget::setCompactStorageEnabled(bool enable) {
+    m_memoryProvider->setCompactStorage(enable);
+}
 
-void QImagesWidget::setUpdateEnabled(bool enable) { m_enableUpdate = enable; }
+QImagesWidget::MemoryStats QImagesWidget::memoryStats() const {
+    MemoryStats stats;
+    stats.sourceBytes = m_provider->memoryUsage();
+    stats.mipmapBytes = static_cast<qint64>(m_mipmapCache.totalCost()) * 1024;
+    stats.pixmapCacheBytes =
+        static_cast<qint64>(m_pixmapCache.totalCost()) * 1024;
+    stats.windowSourceBytes =
+        static_cast<qint64>(m_windowSourceCache.totalCost()) * 1024;
+
+    for (const auto &cell : m_cells) {
+        if (!cell.view || cell.imageIndex < 0) {
+            continue;
+        }
+        // 缓存中的像素图与视图共享数据，已计入缓存
+        if (!m_pixmapCache.contains(cell.pixmapKey)) {
+            stats.displayBytes += pixmapBytes(cell.view->pixmap());
+        }
+        auto sourceKey = cell.pixmapKey;
+        sourceKey.window = 0;
+        if (!m_windowSourceCache.contains(sourceKey)) {
+            stats.windowSourceBytes += cell.windowSource.sizeInBytes();
+        }
+    }
 
-QPair<double, double> QImagesWidget::sceneOffset(int r, int c) const {
-    auto itemView = this->itemView(r, c);
-    if (!itemView) {
-        return qMakePair(0.0, 0.0);
+    for (const auto &rendered : m_cineImages) {
+        stats.cineBytes +=
+            rendered.image.sizeInBytes() + rendered.windowSource.sizeInBytes();
     }
-    return itemView->sceneOffset();
+    return stats;
 }
 
-void QImagesWidget::setSceneOffset(int r, int c, double hOffset,
-                                   double vOffset) {
-    auto itemView = this->itemView(r, c);
-    if (!itemView) {
+void QImagesWidget::setProvider(QImagesProvider *provider) {
+    if (!provider) {
+        provider = m_memoryProvider;
+    }
+    if (m_provider == provider) {
         return;
     }
 
-    itemView->setSceneOffset(hOffset, vOffset);
+    if (m_provider) {
+        disconnect(m_provider, nullptr, this, nullptr);
+    }
 
-    updateGrid();
-    updateMarkers();
+    // 工作线程可能仍在读取旧数据源
+    cancelPrefetch();
+    cancelCineFrames();
+    m_prefetchPool.clear();
+    m_prefetchPool.waitForDone();
+    cancelExportAll();
+    m_exportPool.waitForDone();
+
+    m_provider = provider;
+    connect(provider, &QImagesProvider::countChanged, this,
+            &QImagesWidget::onProviderCountChanged);
+    connect(provider, &QImagesProvider::imageChanged, this,
+            &QImagesWidget::invalidate);
+    connect(provider, &QImagesProvider::reset, this,
+            &QImagesWidget::resetImages);
+    // 数据源必须比控件存活得更久，或在销毁前先切换掉。destroyed()在~QObject中发出，
+    // 此时工作线程可能仍在其image()中，已无法安全恢复，只报告错误并停止使用该对象
+    if (provider != m_memoryProvider) {
+        connect(provider, &QObject::destroyed, this, [this](QObject *object) {
+            if (object != m_provider) {
+                return;
+            }
+            LOG_ERROR("setProvider: provider destroyed while still attached; "
+                      "call setProvider(nullptr) before deleting it");
+            Q_ASSERT_X(false, "QImagesWidget",
+                       "provider destroyed while still attached");
+            m_provider = nullptr;
+            setProvider(m_memoryProvider);
+        });
+    }
+
+    resetImages();
 }
 
-bool QImagesWidget::addItem(int row, int col, QGraphicsItem *item) {
-    if (!isValidIndex(row, col) || !item) {
-        return false;
-    }
+void QImagesWidget::appendImage(const QImage &image) {
+    appendImages({image});
+}
 
-    auto view = this->view(row, col);
-    if (view && view->scene()) {
-        view->scene()->addItem(item);
-        return true;
+void QImagesWidget::appendImages(const QList<QImage> &images) {
+    if (images.isEmpty()) {
+        return;
     }
-    return false;
-}
 
-bool QImagesWidget::addItem(int index, QGraphicsItem *item) {
-    if (index < 0 || !item || m_colNum == 0) {
-        return false;
+    if (m_provider != m_memoryProvider) {
+        LOG_ERROR("appendImages: images are supplied by an external provider");
+        return;
     }
+    // 内存数据源发出countChanged信号后由onProviderCountChanged刷新
+    m_memoryProvider->appendImages(images);
+}
 
-    int row = index / m_colNum;
-    int col = index % m_colNum;
-    return addItem(row, col, item);
+size_t QImagesWidget::imageCount() const {
+    return m_provider ? m_provider->count() : 0;
 }
 
-const QGraphicsView *QImagesWidget::view(int row, int col) const {
-    if (!isValidIndex(row, col)) {
-        return nullptr;
+void QImagesWidget::resetImages() {
+    m_pageIndex = 0;
+    m_imageShift = 0;
+    clearPixmapCache();
+    m_mipmapCache.clear();
+
+    // 新的图像序列，所有单元都需要重新设置图像
+    for (auto &cell : m_cells) {
+        cell.imageIndex = -1;
+        cell.dirty = true;
     }
 
-    auto grid = gridLayout();
-    if (!grid) {
-        return nullptr;
-    }
+    updateGrid();
+    updateMarkers();
+    emit imageCountChanged(imageCount());
+}
 
-    auto item = grid->itemAtPosition(row, col);
-    if (!item) {
-        return nullptr;
+void QImagesWidget::onProviderCountChanged(size_t count) {
+    // 只有落在当前页的新单元会被绘制，其余单元保持不变；
+    // 连续滚动时新增的行只扩展内容区域
+    if (m_continuousScroll && gridRows() != m_cellRows) {
+        updateGrid();
     }
-
-    return qobject_cast<QGraphicsView *>(item->widget());
+    updateMarkers();
+    emit imageCountChanged(count);
 }
 
-QImagesWidgetItemView *QImagesWidget::itemView(int row, int col) const {
-    if (!isValidIndex(row, col)) {
-        return nullptr;
+void QImagesWidget::invalidate(size_t index) {
+    removeCachedPixmaps(index);
+    m_mipmapCache.remove(index);
+
+    // 正在后台缩放的旧图像结果不能再进入缓存
+    for (auto it = m_prefetchPending.begin(); it != m_prefetchPending.end();) {
+        if (it.key().index == index) {
+            it.value()->storeRelease(PrefetchDropped);
+            it = m_prefetchPending.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    // 电影播放已渲染的旧图像直接丢弃，正在渲染的旧图像需要取消任务
+    bool cinePending = false;
+    for (auto it = m_cineImages.begin(); it != m_cineImages.end();) {
+        if (it.key().index == index) {
+            it = m_cineImages.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (const auto &key : m_cinePending) {
+        if (key.index == index) {
+            cinePending = true;
+            break;
+        }
+    }
+    if (cinePending) {
+        cancelCineFrames();
     }
 
-    auto grid = gridLayout();
-    if (!grid) {
-        return nullptr;
+    bool visible = false;
+    for (auto &cell : m_cells) {
+        if (cell.imageIndex == static_cast<qint64>(index)) {
+            cell.dirty = true;
+            visible = true;
+        }
     }
 
-    auto item = grid->itemAtPosition(row, col);
-    if (!item) {
-        return nullptr;
+    if (visible) {
+        updateMarkers();
     }
+}
 
-    return qobject_cast<QImagesWidgetItemView *>(item->widget());
+Qt::TransformationMode QImagesWidget::transformationMode() const {
+    return m_transformationMode;
 }
 
-void QImagesWidget::updateMarkers() {
-    if (!m_enableUpdate || m_images.isEmpty()) {
+void QImagesWidget::setTransformationMode(Qt::TransformationMode mode) {
+    if (m_transformationMode == mode) {
         return;
     }
+    m_transformationMode = mode;
+    // 已登记的预渲染图像按旧的缩放方式生成
+    cancelCineFrames();
+    updateMarkers();
+}
 
+QImagesResampler::Filter QImagesWidget::resampleFilter() const {
+    return m_resampleFilter;
+}
+
+void QImagesWidget::setResampleFilter(QImagesResampler::Filter filter) {
+    if (m_resampleFilter == filter) {
+        return;
+    }
+    m_resampleFilter = filter;
+
+    // 缓存键不包含滤波器，已有结果全部失效
+    clearPixmapCache();
+    for (auto &cell : m_cells) {
+        cell.dirty = true;
+    }
+    updateMarkers();
+}
+
+bool QImagesWidget::isMipmapEnabled() const { return m_mipmapEnabled; }
+
+void QImagesWidget::setMipmapEnabled(bool enable) {
+    if (m_mipmapEnabled == enable) {
+        return;
+    }
+    m_mipmapEnabled = enable;
+    if (!enable) {
+        m_mipmapCache.clear();
+    }
+}
+
+int QImagesWidget::mipmapCacheLimit() const {
+    return m_mipmapCache.cacheLimit();
+}
+
+void QImagesWidget::setMipmapCacheLimit(int kbytes) {
+    m_mipmapCache.setCacheLimit(kbytes);
+}
+
+double QImagesWidget::windowCenter() const { return m_windowCenter; }
+
+double QImagesWidget::windowWidth() const { return m_windowWidth; }
+
+void QImagesWidget::setWindowLevel(double center, double width) {
+    // 查找表由这两个值直接计算，只有完全相同时才跳过；qFuzzyCompare对0不适用
+    width = qMax(1.0, width);
+    if (m_windowCenter == center && m_windowWidth == width) {
+        return;
+    }
+
+    m_windowCenter = center;
+    m_windowWidth = width;
+    updateWindowLut();
+
+    // 旧窗宽窗位的缓存结果不会再被命中，序号0保留给与窗宽窗位无关的图像
+    if (++m_windowSerial == 0) {
+        m_windowSerial = 1;
+    }
+    cancelPrefetch();
+
+    // 可见单元直接重新映射已缩放的16位图像，不重新缩放
+    for (auto &cell : m_cells) {
+        if (!cell.view || cell.imageIndex < 0 || cell.pixmapKey.window == 0) {
+            continue;
+        }
+        if (cell.windowSource.isNull()) {
+            cell.dirty = true;
+            continue;
+        }
+
+        auto pixmap =
+            uploadPixmap(applyWindowLut(cell.windowSource, m_windowLut));
+        cell.pixmapKey.window = m_windowSerial;
+        insertPixmap(cell.pixmapKey, pixmap);
+        cell.view->updatePixmap(pixmap);
+    }
+
+    updateMarkers();
+}
+
+int QImagesWidget::pixmapCacheLimit() const {
+    return static_cast<int>(m_pixmapCache.maxCost());
+}
+
+void QImagesWidget::setPixmapCacheLimit(int kbytes) {
+    m_pixmapCache.setMaxCost(qMax(0, kbytes));
+    m_windowSourceCache.setMaxCost(qMax(0, kbytes));
+}
+
+void QImagesWidget::clearPixmapCache() {
+    cancelPrefetch();
+    cancelCineFrames();
+    m_pixmapCache.clear();
+    m_windowSourceCache.clear();
+}
+
+quint64 QImagesWidget::pixmapCacheHits() const { return m_pixmapCacheHits; }
+
+quint64 QImagesWidget::pixmapCacheMisses() const {
+    return m_pixmapCacheMisses;
+}
+
+void QImagesWidget::resetPixmapCacheStats() {
+    m_pixmapCacheHits = 0;
+    m_pixmapCacheMisses = 0;
+}
+
+int QImagesWidget::prefetchDepth() const { return m_prefetchDepth; }
+
+void QImagesWidget::setPrefetchDepth(int pages) {
+    pages = qMax(0, pages);
+    if (m_prefetchDepth == pages) {
+        return;
+    }
+    m_prefetchDepth = pages;
+    // 刷新时按新的深度撤销窗口外的任务
+    updateMarkers();
+}
+
+void QImagesWidget::play() {
+    if (isPlaying() || m_continuousScroll || cineFrameCount() == 0) {
+        return;
+    }
+
+    // 单次播放已停在末尾时从头开始
+    bool stopped = false;
+    int direction = m_cineDirection;
+    nextCineFrame(cineFrame(), direction, &stopped);
+    if (stopped) {
+        m_cineDirection = 1;
+        showCineFrame(0);
+    }
+
+    // 播放期间由电影播放的预渲染代替分页预取
+    trimPrefetch({});
+    m_cineClock.start();
+    m_cineTicks = 0;
+    m_cineShownTimes.clear();
+    scheduleCineFrames();
+
+    // 以半帧间隔检查，按时钟而不是定时器次数决定显示哪一帧
+    m_cineTimer.start(qMax(1, qRound(500.0 / m_cineFps)));
+    emit cinePlayingChanged(true);
+}
+
+void QImagesWidget::pause() {
+    if (!isPlaying()) {
+        return;
+    }
+    m_cineTimer.stop();
+    cancelCineFrames();
+    m_cineStats.fps = 0.0;
+    updateMarkers();
+    emit cinePlayingChanged(false);
+}
+
+bool QImagesWidget::isPlaying() const { return m_cineTimer.isActive(); }
+
+double QImagesWidget::cineFps() const { return m_cineFps; }
+
+void QImagesWidget::setCineFps(double fps) {
+    if (fps <= 0.0 || qFuzzyCompare(m_cineFps, fps)) {
+        return;
+    }
+    m_cineFps = fps;
+    if (isPlaying()) {
+        m_cineClock.restart();
+        m_cineTicks = 0;
+        m_cineTimer.setInterval(qMax(1, qRound(500.0 / m_cineFps)));
+    }
+}
+
+QImagesWidget::CineLoopMode QImagesWidget::cineLoopMode() const {
+    return m_cineLoopMode;
+}
+
+void QImagesWidget::setCineLoopMode(CineLoopMode mode) {
+    m_cineLoopMode = mode;
+    if (mode != Bounce) {
+        m_cineDirection = 1;
+    }
+}
+
+QImagesWidget::CineStep QImagesWidget::cineStep() const { return m_cineStep; }
+
+void QImagesWidget::setCineStep(CineStep step) {
+    if (m_cineStep == step) {
+        return;
+    }
+    m_cineStep = step;
+    cancelCineFrames();
+
+    // 切换到按页播放时对齐到当前页
+    if (step == PageStep && m_imageShift != 0) {
+        showCineFrame(m_pageIndex);
+    }
+    if (isPlaying()) {
+        scheduleCineFrames();
+    }
+}
+
+size_t QImagesWidget::cineFrame() const {
+    return m_cineStep == PageStep ? m_pageIndex : firstImageIndex();
+}
+
+bool QImagesWidget::setCineFrame(size_t frame) {
+    if (m_continuousScroll || frame >= cineFrameCount()) {
+        return false;
+    }
+    showCineFrame(frame);
+    if (isPlaying()) {
+        m_cineClock.restart();
+        m_cineTicks = 0;
+        scheduleCineFrames();
+    }
+    return true;
+}
+
+size_t QImagesWidget::cineFrameCount() const {
+    if (m_cineStep == PageStep) {
+        return pageCount();
+    }
+
+    // 停在最后一帧时网格仍然是满的
+    size_t count = imageCount();
+    size_t imagesPerPage = m_rowNum * m_colNum;
+    if (count == 0 || imagesPerPage == 0) {
+        return 0;
+    }
+    return count > imagesPerPage ? count - imagesPerPage + 1 : 1;
+}
+
+int QImagesWidget::cineBufferFrames() const {
+    return static_cast<int>(m_cineBuffer.size());
+}
+
+void QImagesWidget::setCineBufferFrames(int frames) {
+    frames = qMax(1, frames);
+    if (m_cineBuffer.size() == frames) {
+        return;
+    }
+    cancelCineFrames();
+    m_cineBuffer.resize(frames);
+    if (isPlaying()) {
+        scheduleCineFrames();
+    }
+}
+
+QImagesWidget::CineStats QImagesWidget::cineStats() const {
+    return m_cineStats;
+}
+
+void QImagesWidget::resetCineStats() {
+    m_cineStats = CineStats();
+    m_cineLatencyCount = 0;
+    m_cineShownTimes.clear();
+}
+
+QImagesExporter *QImagesWidget::exporter() const { return m_exporter; }
+
+int QImagesWidget::exportImage(int row, int col, const QString &fileName,
+                               bool withObjects) {
+    auto view = itemView(row, col);
+    return view ? view->exportImage(fileName, withObjects) : -1;
+}
+
+QSize QImagesWidget::pageImageSize(qreal scale) const {
+    if (m_rowNum == 0 || m_colNum == 0 || scale <= 0) {
+        return QSize();
+    }
+    auto width = m_colNum * m_viewWidth + (m_colNum - 1) * m_horizontalSpacing;
+    auto height = m_rowNum * m_viewHeight + (m_rowNum - 1) * m_verticalSpacing;
+    return QSize(qRound(width * scale), qRound(height * scale));
+}
+
+QImage QImagesWidget::renderPage(size_t pageIndex, qreal scale) {
+    return renderPageRegion(pageIndex, scale,
+                            QRect(QPoint(0, 0), pageImageSize(scale)));
+}
+
+QImage QImagesWidget::renderPageRegion(size_t pageIndex, qreal scale,
+                                       const QRect &region) {
+    QIMAGES_PROFILE_SCOPE(Render);
+    if (pageIndex >= pageCount() || scale <= 0 || region.isEmpty() ||
+        sceneWidth() == 0 || sceneHeight() == 0) {
+        return QImage();
+    }
+
+    QImage output(region.size(), QImage::Format_RGB32);
+    if (output.isNull()) {
+        LOG_ERROR("renderPageRegion: failed to allocate the output image");
+        return output;
+    }
+    output.fill(Qt::black);
+
+    // 当前拥有视图的单元按矢量绘制其图形项，其余图像绘制图形层模型
+    QHash<size_t, QImagesWidgetItemView *> views;
+    for (const auto &cell : m_cells) {
+        if (cell.view && cell.imageIndex >= 0) {
+            views.insert(static_cast<size_t>(cell.imageIndex), cell.view);
+        }
+    }
+    auto model = m_overlayModel;
+    auto overlays = [&views, model](QPainter *painter, size_t index,
+                                    const QRectF &cell, const QRectF &scene) {
+        if (auto view = views.value(index)) {
+            view->renderOverlays(painter, cell, scene);
+        } else if (model->hasShapes(index)) {
+            painter->translate(cell.topLeft() - scene.topLeft());
+            model->paint(painter, index, scene);
+        }
+    };
+
+    QPainter painter(&output);
+    paintPageRegion(&painter, pageLayout(), pageIndex, scale, region,
+                    renderOptions(), overlays);
+    painter.end();
+    return output;
+}
+
+QImagesWidget::PageLayout QImagesWidget::pageLayout() const {
+    PageLayout layout;
+    layout.rows = m_rowNum;
+    layout.cols = m_colNum;
+    layout.cellSize = QSize(static_cast<int>(m_viewWidth),
+                            static_cast<int>(m_viewHeight));
+    layout.horizontalSpacing = m_horizontalSpacing;
+    layout.verticalSpacing = m_verticalSpacing;
+    layout.sceneSize = QSizeF(static_cast<qreal>(sceneWidth()),
+                              static_cast<qreal>(sceneHeight()));
+    layout.imageCount = imageCount();
+
+    // 偏移按图像索引查找，连续滚动时单元的行号与页内行号不对应，
+    // 不在任何单元中的图像没有偏移
+    for (const auto &cell : m_cells) {
+        if (cell.imageIndex >= 0) {
+            layout.offsets.insert(static_cast<size_t>(cell.imageIndex),
+                                  QPointF(cell.sceneOffset.first,
+                                          cell.sceneOffset.second));
+        }
+    }
+    return layout;
+}
+
+void QImagesWidget::paintPageRegion(QPainter *painter,
+                                    const PageLayout &layout, size_t pageIndex,
+                                    qreal scale, const QRect &region,
+                                    const RenderOptions &options,
+                                    const OverlayPainter &overlays,
+                                    const QAtomicInt *cancelled) {
+    const auto &sceneSize = layout.sceneSize;
+    size_t first = pageIndex * layout.rows * layout.cols;
+
+    // 图像在输出坐标系中分块绘制，图形项在布局坐标系中绘制，由画家完成缩放
+    painter->save();
+    painter->setRenderHint(QPainter::SmoothPixmapTransform);
+    painter->setRenderHint(QPainter::Antialiasing);
+    painter->translate(-region.topLeft());
+
+    for (size_t row = 0; row < layout.rows; row++) {
+        for (size_t col = 0; col < layout.cols; col++) {
+            if (cancelled && cancelled->loadAcquire()) {
+                painter->restore();
+                return;
+            }
+
+            size_t index = first + row * layout.cols + col;
+            QRect rect(static_cast<int>(col) * (layout.cellSize.width() +
+                                                layout.horizontalSpacing),
+                       static_cast<int>(row) * (layout.cellSize.height() +
+                                                layout.verticalSpacing),
+                       layout.cellSize.width(), layout.cellSize.height());
+            QRectF scaledRect(rect.x() * scale, rect.y() * scale,
+                              rect.width() * scale, rect.height() * scale);
+            if (index >= layout.imageCount || !scaledRect.intersects(region)) {
+                continue;
+            }
+
+            // 与视图的显示方式一致：场景矩形居中，图像按单元的偏移移动。
+            // 场景原点（图像中心）位于单元中心减去偏移处
+            auto offset = layout.offsets.value(index);
+            QRectF target(QPointF(), sceneSize);
+            target.moveCenter(QRectF(rect).center() - offset);
+            QRectF scene(offset.x() - rect.width() / 2.0,
+                         offset.y() - rect.height() / 2.0, rect.width(),
+                         rect.height());
+            QRectF scaledTarget(target.x() * scale, target.y() * scale,
+                                target.width() * scale,
+                                target.height() * scale);
+
+            painter->save();
+            painter->setClipRect(scaledRect);
+            auto visible =
+                (scaledRect & scaledTarget).toAlignedRect() & region;
+            if (!visible.isEmpty()) {
+                paintImageTiles(painter, index, scaledTarget, visible, options,
+                                cancelled);
+            }
+            if (overlays) {
+                painter->scale(scale, scale);
+                overlays(painter, index, QRectF(rect), scene);
+            }
+            painter->restore();
+        }
+    }
+    painter->restore();
+}
+
+void QImagesWidget::paintImageTiles(QPainter *painter, size_t index,
+                                    const QRectF &target, const QRect &visible,
+                                    const RenderOptions &options,
+                                    const QAtomicInt *cancelled) {
+    // 与renderImage()一致，平滑缩放时从不小于目标尺寸的最小一级金字塔取图
+    QSize size(qMax(1, qRound(target.width())),
+               qMax(1, qRound(target.height())));
+    auto provider = options.provider;
+    QImage image;
+    if (options.mipmaps && options.mode == Qt::SmoothTransformation) {
+        image = options.mipmaps->levelFor(
+            index, size, [provider, index]() { return provider->image(index); });
+    } else {
+        image = provider->image(index);
+    }
+    if (image.isNull()) {
+        return;
+    }
+
+    // 原图像素与输出像素之比；每块四周多取滤波器支撑范围内的原图像素，
+    // 块的边缘与整张缩放的结果一致，块之间没有接缝
+    qreal ratioX = image.width() / target.width();
+    qreal ratioY = image.height() / target.height();
+    qreal marginX = 3 * qMax<qreal>(1, ratioX);
+    qreal marginY = 3 * qMax<qreal>(1, ratioY);
+
+    for (int y = visible.top(); y <= visible.bottom(); y += pageTileSide) {
+        for (int x = visible.left(); x <= visible.right(); x += pageTileSide) {
+            if (cancelled && cancelled->loadAcquire()) {
+                return;
+            }
+
+            auto tile = QRect(x, y, pageTileSide, pageTileSide) & visible;
+            QRectF wanted((tile.x() - target.x()) * ratioX,
+                          (tile.y() - target.y()) * ratioY,
+                          tile.width() * ratioX, tile.height() * ratioY);
+            auto source =
+                wanted.adjusted(-marginX, -marginY, marginX, marginY)
+                    .toAlignedRect() &
+                image.rect();
+            if (source.isEmpty()) {
+                continue;
+            }
+
+            // 只缩放这一块需要的原图区域
+            QSize tileSize(qMax(1, qRound(source.width() / ratioX)),
+                           qMax(1, qRound(source.height() / ratioY)));
+            auto scaled = scaleImage(
+                source == image.rect() ? image : image.copy(source), tileSize,
+                options);
+            if (scaled.format() == QImage::Format_Grayscale16) {
+                scaled = applyWindowLut(scaled, options.windowLut);
+            }
+
+            painter->save();
+            painter->setClipRect(tile, Qt::IntersectClip);
+            painter->drawImage(QRectF(target.x() + source.x() / ratioX,
+                                      target.y() + source.y() / ratioY,
+                                      source.width() / ratioX,
+                                      source.height() / ratioY),
+                               scaled);
+            painter->restore();
+        }
+    }
+}
+
+bool QImagesWidget::exportAll(const QString &directory,
+                              const QByteArray &format, bool withObjects,
+                              ExportMode mode) {
+    if (m_exportBatch.active || sceneWidth() == 0 || sceneHeight() == 0) {
+        return false;
+    }
+
+    size_t total = mode == ExportPerImage ? imageCount() : pageCount();
+    if (total == 0 || !QDir().mkpath(directory)) {
+        return false;
+    }
+
+    ExportBatch batch;
+    batch.id = m_exportBatch.id + 1;
+    batch.active = true;
+    batch.directory = directory;
+    batch.format = format.isEmpty() ? QByteArray("png") : format;
+    batch.mode = mode;
+    batch.total = total;
+    batch.cancelled = QSharedPointer<QAtomicInt>::create(0);
+    batch.pageSize = pageImageSize();
+    batch.layout = pageLayout();
+    batch.options = renderOptions();
+
+    // 图形项只能在GUI线程中渲染，开始前对拥有视图的单元各渲染一次；
+    // 其余图像复制图形层的图元，之后对模型的修改不影响本次导出
+    if (withObjects) {
+        for (const auto &cell : m_cells) {
+            if (!cell.view || cell.imageIndex < 0 || !cell.view->hasOverlays()) {
+                continue;
+            }
+            auto index = static_cast<size_t>(cell.imageIndex);
+            if (mode == ExportPerImage) {
+                auto image = cell.view->grabImage(true);
+                if (!image.isNull()) {
+                    batch.overlays.insert(index, image);
+                }
+                continue;
+            }
+
+            // 按页导出时只渲染单元中可见的图形项，拼图时叠加在图像上
+            auto offset = batch.layout.offsets.value(index);
+            QSizeF cellSize(batch.layout.cellSize);
+            QImage layer(batch.layout.cellSize,
+                         QImage::Format_ARGB32_Premultiplied);
+            if (layer.isNull()) {
+                continue;
+            }
+            layer.fill(Qt::transparent);
+            QPainter painter(&layer);
+            painter.setRenderHint(QPainter::Antialiasing);
+            cell.view->renderOverlays(
+                &painter, QRectF(layer.rect()),
+                QRectF(offset - QPointF(cellSize.width() / 2,
+                                        cellSize.height() / 2),
+                       cellSize));
+            painter.end();
+            batch.overlays.insert(index, layer);
+        }
+        size_t count = imageCount();
+        for (size_t index = 0; index < count; index++) {
+            if (!batch.overlays.contains(index) &&
+                m_overlayModel->hasShapes(index)) {
+                batch.shapes.insert(index, m_overlayModel->shapes(index));
+            }
+        }
+    }
+
+    batch.clock.start();
+    m_exportBatch = batch;
+    submitExportJobs();
+    return true;
+}
+
+void QImagesWidget::cancelExportAll() {
+    if (abortExportAll()) {
+        emit exportAllFinished(false, m_exportBatch.written, tr("Export cancelled"));
+    }
+}
+
+bool QImagesWidget::abortExportAll() {
+    if (!m_exportBatch.active) {
+        return false;
+    }
+    m_exportBatch.cancelled->storeRelease(1);
+    m_exportPool.clear();
+    m_exportBatch.inFlight = 0;
+    m_exportBatch.active = false;
+    m_exportBatch.overlays.clear();
+    m_exportBatch.shapes.clear();
+    return true;
+}
+
+bool QImagesWidget::isExportingAll() const { return m_exportBatch.active; }
+
+QString QImagesWidget::exportFileName(ExportMode mode, size_t unit,
+                                      size_t total, const QByteArray &format) {
+    // 位数由总数决定，至少4位，文件按名称排序即为导出顺序
+    int digits = qMax(
+        4, static_cast<int>(
+               QString::number(static_cast<qulonglong>(total)).size()));
+    return QString("%1_%2.%3")
+        .arg(QString(mode == ExportPerImage ? "image" : "page"))
+        .arg(static_cast<qulonglong>(unit), digits, 10, QChar('0'))
+        .arg(QString::fromLatin1(format).toLower());
+}
+
+int QImagesWidget::horizontalSpacing() const { return m_horizontalSpacing; }
+
+void QImagesWidget::setHorizontalSpacing(int spacing) {
+    if (m_horizontalSpacing == spacing || spacing < 0) {
+        return;
+    }
+    m_horizontalSpacing = spacing;
+    updateGrid();
+    updateMarkers();
+}
+
+int QImagesWidget::verticalSpacing() const { return m_verticalSpacing; }
+
+void QImagesWidget::setVerticalSpacing(int spacing) {
+    if (m_verticalSpacing == spacing || spacing < 0) {
+        return;
+    }
+    m_verticalSpacing = spacing;
+    updateGrid();
+    updateMarkers();
+}
+
+bool QImagesWidget::isVirtualizationEnabled() const { return m_virtualized; }
+
+void QImagesWidget::setVirtualizationEnabled(bool enable) {
+    if (m_virtualized == enable) {
+        return;
+    }
+    m_virtualized = enable;
+    updateVisibleCells();
+    updateMarkers();
+}
+
+int QImagesWidget::virtualizationMargin() const {
+    return m_virtualizationMargin;
+}
+
+bool QImagesWidget::isContinuousScrollEnabled() const {
+    return m_continuousScroll;
+}
+
+void QImagesWidget::setContinuousScrollEnabled(bool enable) {
+    if (m_continuousScroll == enable) {
+        return;
+    }
+    if (enable) {
+        pause();
+    }
+    m_continuousScroll = enable;
+
+    // 两种模式下单元对应的图像不同，需要全部重新设置
+    for (auto &cell : m_cells) {
+        cell.imageIndex = -1;
+        cell.dirty = true;
+    }
+
+    size_t page = m_pageIndex;
+    updateGrid();
+    if (enable) {
+        setPageIndex(qMin(page, qMax<size_t>(pageCount(), 1) - 1));
+    } else {
+        m_scrollArea->verticalScrollBar()->setValue(0);
+    }
+    updateMarkers();
+}
+
+bool QImagesWidget::isLinkedNavigationEnabled() const {
+    return m_linkedNavigation;
+}
+
+void QImagesWidget::setLinkedNavigationEnabled(bool enable) {
+    if (m_linkedNavigation == enable) {
+        return;
+    }
+    m_linkedNavigation = enable;
+
+    for (const auto &cell : m_cells) {
+        if (cell.view) {
+            cell.view->setNavigationEnabled(enable);
+        }
+    }
+    if (!enable) {
+        resetNavigation();
+    }
+}
+
+double QImagesWidget::zoom() const { return m_zoom; }
+
+void QImagesWidget::setZoom(double zoom) {
+    zoom = qBound(0.25, zoom, 64.0);
+    if (qFuzzyCompare(m_zoom, zoom)) {
+        return;
+    }
+    m_zoom = zoom;
+    scheduleNavigation();
+}
+
+QPointF QImagesWidget::pan() const { return m_pan; }
+
+void QImagesWidget::setPan(const QPointF &pan) {
+    if (m_pan == pan) {
+        return;
+    }
+    m_pan = pan;
+    scheduleNavigation();
+}
+
+void QImagesWidget::resetNavigation() {
+    m_zoom = 1.0;
+    m_pan = QPointF();
+    scheduleNavigation();
+}
+
+void QImagesWidget::onZoomRequested(double factor, const QPointF &anchor) {
+    if (!m_linkedNavigation || factor <= 0) {
+        return;
+    }
+
+    // 保持鼠标下的场景点不动：中心向锚点移动(1 - 旧比例/新比例)
+    double oldZoom = m_zoom;
+    double zoom = qBound(0.25, m_zoom * factor, 64.0);
+    m_pan += anchor * (1.0 - oldZoom / zoom);
+    m_zoom = zoom;
+    scheduleNavigation();
+}
+
+void QImagesWidget::onPanRequested(const QPointF &delta) {
+    if (!m_linkedNavigation) {
+        return;
+    }
+    m_pan += delta;
+    scheduleNavigation();
+}
+
+void QImagesWidget::scheduleNavigation() {
+    if (!m_navigationTimer.isActive()) {
+        m_navigationTimer.start();
+    }
+}
+
+void QImagesWidget::applyNavigation() {
+    for (const auto &cell : m_cells) {
+        if (cell.view) {
+            cell.view->setViewTransform(m_zoom, m_pan);
+        }
+    }
+    if (m_renderBackend == BatchedBackend) {
+        m_contentWidget->update();
+    }
+
+    // 缩放停止一段时间后才按新的分辨率重新缩放
+    m_detailTimer.start();
+}
+
+void QImagesWidget::updateDetailZoom() {
+    // 取不小于缩放比例的2的幂，小幅缩放不会触发重新缩放
+    double detail = 1.0;
+    while (detail < m_zoom && detail < 8.0) {
+        detail *= 2.0;
+    }
+    if (qFuzzyCompare(detail, m_detailZoom)) {
+        return;
+    }
+    m_detailZoom = detail;
+    cancelPrefetch();
+    cancelCineFrames();
+    updateMarkers();
+}
+
+QSize QImagesWidget::renderSize() const {
+    // 限制像素图的边长，避免高倍缩放时分配过大的图像
+    constexpr double maxSide = 4096.0;
+    double side = qMax(sceneWidth(), sceneHeight());
+    double detail = m_detailZoom;
+    if (side * detail > maxSide) {
+        detail = qMax(1.0, maxSide / side);
+    }
+    return QSize(qRound(sceneWidth() * detail), qRound(sceneHeight() * detail));
+}
+
+QImagesWidget::RenderBackend QImagesWidget::renderBackend() const {
+    return m_renderBackend;
+}
+
+void QImagesWidget::setRenderBackend(RenderBackend backend) {
+    if (m_renderBackend == backend) {
+        return;
+    }
+    m_renderBackend = backend;
+
+    // 只切换视图的显示方式，场景和其中的图形项保持不变
+    for (size_t row = 0; row < m_cellRows; row++) {
+        for (size_t col = 0; col < m_cellCols; col++) {
+            auto &cell = m_cells[static_cast<int>(row * m_cellCols + col)];
+            if (cell.view) {
+                configureView(cell, row, col);
+            }
+        }
+    }
+    m_contentWidget->update();
+}
+
+void QImagesWidget::setVirtualizationMargin(int cells) {
+    cells = qMax(0, cells);
+    if (m_virtualizationMargin == cells) {
+        return;
+    }
+    m_virtualizationMargin = cells;
+    updateVisibleCells();
+    updateMarkers();
+}
+
+bool QImagesWidget::isUpdateEnabled() const { return m_enableUpdate; }
+
+void QImagesWidget::setUpdateEnabled(bool enable) { m_enableUpdate = enable; }
+
+QPair<double, double> QImagesWidget::sceneOffset(int r, int c) const {
+    auto cell = cellAt(r, c);
+    if (!cell) {
+        return qMakePair(0.0, 0.0);
+    }
+    // 单元中保存相对于图像居中位置的偏移，对外换算为场景矩形的左上角
+    return qMakePair(cell->sceneOffset.first - sceneWidth() / 2.0,
+                     cell->sceneOffset.second - sceneHeight() / 2.0);
+}
+
+void QImagesWidget::setSceneOffset(int r, int c, double hOffset,
+                                   double vOffset) {
+    auto cell = cellAt(r, c);
+    if (!cell) {
+        return;
+    }
+
+    // 只移动该单元的视图，不重建网格也不重新缩放图像
+    auto &mutableCell = m_cells[static_cast<int>(r * m_cellCols + c)];
+    mutableCell.sceneOffset = qMakePair(hOffset + sceneWidth() / 2.0,
+                                        vOffset + sceneHeight() / 2.0);
+    if (mutableCell.view) {
+        mutableCell.view->setSceneOffset(hOffset, vOffset);
+        if (m_renderBackend == BatchedBackend) {
+            m_contentWidget->update(cellRect(r, c));
+        }
+    }
+}
+
+bool QImagesWidget::addItem(int row, int col, QGraphicsItem *item) {
+    if (!isValidIndex(row, col) || !item) {
+        return false;
+    }
+
+    auto view = this->view(row, col);
+    if (view && view->scene()) {
+        view->scene()->addItem(item);
+        return true;
+    }
+    return false;
+}
+
+bool QImagesWidget::addItem(int index, QGraphicsItem *item) {
+    if (index < 0 || !item || m_colNum == 0) {
+        return false;
+    }
+
+    int row = index / m_colNum;
+    int col = index % m_colNum;
+    return addItem(row, col, item);
+}
+
+const QGraphicsView *QImagesWidget::view(int row, int col) const {
+    return itemView(row, col);
+}
+
+QImagesWidgetItemView *QImagesWidget::itemView(int row, int col) const {
+    auto cell = cellAt(row, col);
+    return cell ? cell->view : nullptr;
+}
+
+QImagesOverlayModel *QImagesWidget::overlayModel() const {
+    return m_overlayModel;
+}
+
+void QImagesWidget::updateMarkers() {
+    {
+        QIMAGES_PROFILE_SCOPE(UpdateMarkers);
+        refreshVisibleCells();
+    }
+#ifdef QIMAGESWIDGET_ENABLE_PROFILING
+    if (QImagesProfiler::isEnabled()) {
+        emit profileUpdated(QImagesProfiler::stats());
+    }
+#endif
+}
+
+QImagesProfileStats QImagesWidget::profileStats() const {
+    return QImagesProfiler::stats();
+}
+
+void QImagesWidget::refreshVisibleCells() {
+    if (!m_enableUpdate) {
+        return;
+    }
+
+    size_t currentSceneWidth = this->sceneWidth();
+    size_t currentSceneHeight = this->sceneHeight();
+
+    if (currentSceneWidth == 0 ||
+        currentSceneHeight == 0) { // If effective scene size is zero, do nothing
+        LOG_ERROR("Effective scene width or height is zero in updateMarkers. "
+                  "Skipping update.");
+        return;
+    }
+
+    // 放大时像素图以更高的分辨率生成
+    QSize size = renderSize();
+    // 只有可见范围内的单元拥有视图
+    size_t page_offset = firstImageIndex();
+    size_t rowEnd = qMin(m_rangeRowEnd, m_cellRows);
+    size_t colEnd = qMin(m_rangeColEnd, m_cellCols);
+    for (size_t row = m_rangeRowBegin; row < rowEnd; row++) {
+        for (size_t col = m_rangeColBegin; col < colEnd; col++) {
+            size_t index = page_offset + row * m_colNum + col;
+            refreshCell(m_cells[static_cast<int>(row * m_cellCols + col)], index,
+                        size);
+        }
+    }
+
+    // 播放期间由电影播放的预渲染代替分页预取
+    if (imageCount() > 0 && !isPlaying()) {
+        schedulePrefetch(size);
+    }
+}
+
+void QImagesWidget::refreshCell(Cell &cell, size_t index, const QSize &size) {
+    if (!cell.view) {
+        return;
+    }
+
+    if (index >= imageCount()) {
+        if (cell.imageIndex != -1 || cell.dirty) {
+            cell.view->setPixmap(QPixmap());
+            cell.view->overlayItem()->setSource(m_overlayModel, -1);
+            cell.imageIndex = -1;
+            cell.windowSource = QImage();
+            cell.dirty = false;
+        }
+        return;
+    }
+
+    bool sameImage = cell.imageIndex == static_cast<qint64>(index);
+    if (sameImage && !cell.dirty &&
+        isPixmapKeyCurrent(cell.pixmapKey, index, size)) {
+        return;
+    }
+
+    // 缩放图像并设置到自定义视图
+    QImagesPixmapKey key;
+    QImage windowSource;
+    auto pixmap = scaledPixmap(index, size, &key, &windowSource);
+    if (sameImage) {
+        // 同一图像只替换像素图，保留调用者添加的图形项
+        cell.view->updatePixmap(pixmap);
+    } else {
+        cell.view->setPixmap(pixmap);
+        cell.view->setSourceImage([this, index]() {
+            return sourceImage(index, renderOptions());
+        });
+    }
+
+    cell.imageIndex = static_cast<qint64>(index);
+    cell.pixmapKey = key;
+    cell.windowSource = windowSource;
+    cell.sourceSize = QSize();
+    cell.dirty = false;
+
+    // 图元保存在模型中，只需把持久图形层关联到新的图像索引
+    cell.view->overlayItem()->setSource(m_overlayModel, cell.imageIndex);
+}
+
+void QImagesWidget::onOverlayChanged(size_t index) {
+    for (auto &cell : m_cells) {
+        if (cell.view && cell.imageIndex == static_cast<qint64>(index)) {
+            cell.view->overlayItem()->refresh();
+        }
+    }
+}
+
+void QImagesWidget::onOverlayReset() {
+    for (auto &cell : m_cells) {
+        if (cell.view) {
+            cell.view->overlayItem()->refresh();
+        }
+    }
+}
+
+bool QImagesWidget::isPixmapKeyCurrent(const QImagesPixmapKey &key,
+                                       size_t index, const QSize &size) const {
+    return key.index == index && key.size == size &&
+           key.mode == m_transformationMode &&
+           (key.window == 0 || key.window == m_windowSerial);
+}
+
+size_t QImagesWidget::pageCount() const {
+    size_t count = imageCount();
+    if (count == 0 || m_rowNum == 0 || m_colNum == 0) {
+        return 0;
+    }
+
+    size_t imagesPerPage = m_rowNum * m_colNum;
+    return (count + imagesPerPage - 1) / imagesPerPage; // 向上取整
+}
+
+QGraphicsScene *QImagesWidget::scene(int row, int col) const {
+    auto v = view(row, col);
+    return v ? v->scene() : nullptr;
+}
+
+QImage QImagesWidget::imageAt(size_t index) const {
+    if (index >= imageCount()) {
+        return QImage();
+    }
+    return m_provider->image(index);
+}
+
+QImage QImagesWidget::imageAt(int row, int col) const {
+    if (!isValidIndex(row, col)) {
+        return QImage();
+    }
+
+    size_t index = firstImageIndex() + row * m_colNum + col;
+    return imageAt(index);
+}
+
+void QImagesWidget::updateGrid() {
+    QIMAGES_PROFILE_SCOPE(UpdateGrid);
+    if (!m_enableUpdate) {
+        return;
+    }
+
+    // Use getters to ensure correct scene dimensions are used
     size_t currentSceneWidth = this->sceneWidth();
     size_t currentSceneHeight = this->sceneHeight();
 
-    if (currentSceneWidth == 0 ||
-        currentSceneHeight == 0) { // If effective scene size is zero, do nothing
-        LOG_ERROR("Effective scene width or height is zero in updateMarkers. "
-                  "Skipping update.");
+    size_t rows = gridRows();
+    size_t cols = m_colNum;
+    if (currentSceneWidth == 0 || currentSceneHeight == 0) {
+        rows = 0;
+        cols = 0;
+    }
+
+    // 新旧布局重叠部分的视图原样保留，其余视图退役到复用池
+    QVector<Cell> cells(static_cast<int>(rows * cols));
+    for (size_t row = 0; row < m_cellRows; row++) {
+        for (size_t col = 0; col < m_cellCols; col++) {
+            auto &oldCell = m_cells[static_cast<int>(row * m_cellCols + col)];
+            if (row < rows && col < cols) {
+                cells[static_cast<int>(row * cols + col)] = oldCell;
+            } else {
+                retireView(oldCell.view);
+            }
+        }
+    }
+    m_cells = cells;
+    m_cellRows = rows;
+    m_cellCols = cols;
+
+    if (rows == 0 || cols == 0) {
+        m_contentWidget->setFixedSize(0, 0);
+        updateVisibleCells();
+        return;
+    }
+
+    // 已有视图按新布局调整尺寸和位置
+    for (size_t row = 0; row < rows; row++) {
+        for (size_t col = 0; col < cols; col++) {
+            auto &cell = m_cells[static_cast<int>(row * cols + col)];
+            if (cell.view) {
+                configureView(cell, row, col);
+            }
+        }
+    }
+
+    int totalViewsWidth = 0;
+    int totalViewsHeight = 0;
+
+    if (m_colNum > 0) {
+        totalViewsWidth = static_cast<int>(m_colNum * m_viewWidth);
+        if (m_colNum > 1) {
+            totalViewsWidth +=
+                static_cast<int>((m_colNum - 1) * m_horizontalSpacing);
+        }
+    }
+    if (rows > 0) {
+        totalViewsHeight = static_cast<int>(rows * m_viewHeight);
+        if (rows > 1) {
+            totalViewsHeight += static_cast<int>((rows - 1) * m_verticalSpacing);
+        }
+    }
+
+    m_contentWidget->setFixedSize(totalViewsWidth, totalViewsHeight);
+    updateVisibleCells();
+}
+
+void QImagesWidget::updateVisibleCells() {
+    // 上一次范围之外的单元没有视图，只需检查上一次的范围
+    size_t oldRowEnd = qMin(m_rangeRowEnd, m_cellRows);
+    size_t oldColEnd = qMin(m_rangeColEnd, m_cellCols);
+    size_t oldRowBegin = qMin(m_rangeRowBegin, oldRowEnd);
+    size_t oldColBegin = qMin(m_rangeColBegin, oldColEnd);
+
+    if (m_cellRows == 0 || m_cellCols == 0) {
+        m_rangeRowBegin = m_rangeRowEnd = 0;
+        m_rangeColBegin = m_rangeColEnd = 0;
+        return;
+    }
+
+    size_t rowBegin = 0;
+    size_t rowEnd = m_cellRows;
+    size_t colBegin = 0;
+    size_t colEnd = m_cellCols;
+
+    if (m_virtualized || m_continuousScroll) {
+        // 视口在内容控件中的矩形，内容小于视口居中时左上角为负
+        auto viewport = m_scrollArea->viewport();
+        QRect visible(-m_contentWidget->x(), -m_contentWidget->y(),
+                      viewport->width(), viewport->height());
+        qint64 stepX = static_cast<qint64>(m_viewWidth) + m_horizontalSpacing;
+        qint64 stepY = static_cast<qint64>(m_viewHeight) + m_verticalSpacing;
+
+        auto clampIndex = [](qint64 value, size_t count) {
+            return static_cast<size_t>(
+                qBound<qint64>(0, value, static_cast<qint64>(count) - 1));
+        };
+        colBegin = clampIndex(visible.left() / stepX - m_virtualizationMargin,
+                              m_cellCols);
+        colEnd = clampIndex(visible.right() / stepX + m_virtualizationMargin,
+                            m_cellCols) +
+                 1;
+        rowBegin = clampIndex(visible.top() / stepY - m_virtualizationMargin,
+                              m_cellRows);
+        rowEnd = clampIndex(visible.bottom() / stepY + m_virtualizationMargin,
+                            m_cellRows) +
+                 1;
+
+        // 连续滚动时页码跟随视口顶部所在的行
+        if (m_continuousScroll && m_rowNum > 0) {
+            m_pageIndex =
+                clampIndex(visible.top() / stepY, m_cellRows) / m_rowNum;
+        }
+    }
+
+    auto inRange = [&](size_t row, size_t col) {
+        return row >= rowBegin && row < rowEnd && col >= colBegin &&
+               col < colEnd;
+    };
+
+    // 先回收范围外的视图，再为范围内的单元分配视图，使回收的视图能被立即复用
+    for (size_t row = oldRowBegin; row < oldRowEnd; row++) {
+        for (size_t col = oldColBegin; col < oldColEnd; col++) {
+            auto &cell = m_cells[static_cast<int>(row * m_cellCols + col)];
+            if (cell.view && !inRange(row, col)) {
+                retireView(cell.view);
+                cell.view = nullptr;
+                cell.imageIndex = -1;
+                // 离开可见范围的单元不再保留任何缩放结果
+                cell.windowSource = QImage();
+                cell.sourceSize = QSize();
+                cell.dirty = true;
+            }
+        }
+    }
+
+    for (size_t row = rowBegin; row < rowEnd; row++) {
+        for (size_t col = colBegin; col < colEnd; col++) {
+            auto &cell = m_cells[static_cast<int>(row * m_cellCols + col)];
+            if (!cell.view) {
+                cell.view = acquireView();
+                cell.imageIndex = -1;
+                cell.dirty = true;
+                configureView(cell, row, col);
+            }
+        }
+    }
+
+    m_rangeRowBegin = rowBegin;
+    m_rangeRowEnd = rowEnd;
+    m_rangeColBegin = colBegin;
+    m_rangeColEnd = colEnd;
+}
+
+void QImagesWidget::configureView(Cell &cell, size_t row, size_t col) {
+    // 偏移量以网格单元为准，复用的视图也会恢复该单元的偏移
+    auto view = cell.view;
+    view->setSceneSize(QSizeF(static_cast<qreal>(sceneWidth()),
+                              static_cast<qreal>(sceneHeight())));
+    view->setSceneOffset(cell.sceneOffset.first - sceneWidth() / 2.0,
+                         cell.sceneOffset.second - sceneHeight() / 2.0);
+    view->setViewTransform(m_zoom, m_pan);
+    view->setNavigationEnabled(m_linkedNavigation);
+
+    view->setFixedSize(static_cast<int>(m_viewWidth),
+                       static_cast<int>(m_viewHeight));
+    view->move(cellRect(row, col).topLeft());
+
+    if (m_renderBackend == BatchedBackend) {
+        // 场景内容变化时由画布重绘，多个单元的更新会合并到一次绘制中
+        view->hide();
+        connect(view->scene(), &QGraphicsScene::changed, m_contentWidget,
+                &QImagesWidgetCanvas::scheduleRepaint, Qt::UniqueConnection);
+        m_contentWidget->update(cellRect(row, col));
+    } else {
+        disconnect(view->scene(), &QGraphicsScene::changed, m_contentWidget,
+                   &QImagesWidgetCanvas::scheduleRepaint);
+        view->show();
+    }
+}
+
+void QImagesWidget::paintCells(QPainter &painter, const QRect &region) {
+    QIMAGES_PROFILE_SCOPE(Render);
+    painter.fillRect(region, palette().base());
+
+    for (size_t row = 0; row < m_cellRows; row++) {
+        for (size_t col = 0; col < m_cellCols; col++) {
+            auto &cell = m_cells[static_cast<int>(row * m_cellCols + col)];
+            auto rect = cellRect(row, col);
+            if (!cell.view || !rect.intersects(region)) {
+                continue;
+            }
+
+            // 与视图的显示方式一致：场景矩形按缩放比例居中，超出单元的部分被裁剪
+            auto source = cell.view->sceneRect();
+            QRectF target(QPointF(), source.size() * cell.view->zoom());
+            target.moveCenter(QRectF(rect).center());
+            painter.save();
+            painter.setClipRect(rect);
+            cell.view->scene()->render(&painter, target, source,
+                                       Qt::IgnoreAspectRatio);
+            painter.restore();
+        }
+    }
+}
+
+QImagesWidget::Cell *QImagesWidget::cellAtPos(const QPoint &pos) {
+    auto pitchX = m_viewWidth + static_cast<size_t>(m_horizontalSpacing);
+    auto pitchY = m_viewHeight + static_cast<size_t>(m_verticalSpacing);
+    if (pos.x() < 0 || pos.y() < 0 || pitchX == 0 || pitchY == 0) {
+        return nullptr;
+    }
+
+    // 单元等距排列，由坐标直接得到行列，再排除落在间距上的位置
+    size_t col = static_cast<size_t>(pos.x()) / pitchX;
+    size_t row = static_cast<size_t>(pos.y()) / pitchY;
+    if (row >= m_cellRows || col >= m_cellCols ||
+        !cellRect(row, col).contains(pos)) {
+        return nullptr;
+    }
+    auto &cell = m_cells[static_cast<int>(row * m_cellCols + col)];
+    return cell.view ? &cell : nullptr;
+}
+
+void QImagesWidget::handlePointerEvent(QEvent::Type type, const QPoint &pos,
+                                       Qt::MouseButton button,
+                                       Qt::MouseButtons buttons) {
+    // 按下后网格可能被重建，单元仍显示同一图像时才继续使用
+    auto pressedCell = [this]() -> Cell * {
+        if (m_pressCell < 0 || m_pressCell >= m_cells.size()) {
+            return nullptr;
+        }
+        auto &cell = m_cells[m_pressCell];
+        return cell.view && cell.imageIndex == m_pressIndex ? &cell : nullptr;
+    };
+
+    switch (type) {
+    case QEvent::MouseButtonPress: {
+        // 已有按键按下时忽略其他按键
+        auto cell = cellAtPos(pos);
+        if (m_pressCell >= 0 || !cell || cell->imageIndex < 0) {
+            return;
+        }
+        m_pressCell = static_cast<int>(cell - m_cells.data());
+        m_pressIndex = cell->imageIndex;
+        m_pressPos = pos;
+        m_pressButton = button;
+        m_pointerDragging = false;
+        m_pressPixel = sourcePixel(*cell, cellScenePos(*cell, pos), nullptr);
+        return;
+    }
+    case QEvent::MouseMove:
+        if (m_pressCell >= 0) {
+            if (!m_pointerDragging && (pos - m_pressPos).manhattanLength() <
+                                          QApplication::startDragDistance()) {
+                return;
+            }
+            auto cell = pressedCell();
+            if (!cell) {
+                m_pressCell = -1;
+                return;
+            }
+            m_pointerDragging = true;
+            m_dragPixel = sourcePixel(*cell, cellScenePos(*cell, pos), nullptr);
+            m_dragButtons = buttons;
+            m_dragPending = true;
+        } else {
+            auto cell = cellAtPos(pos);
+            bool inside = false;
+            QPointF pixel;
+            if (cell && cell->imageIndex >= 0) {
+                pixel = sourcePixel(*cell, cellScenePos(*cell, pos), &inside);
+            }
+            m_hoverIndex = inside ? cell->imageIndex : -1;
+            m_hoverPixel = pixel;
+            m_hoverPending = true;
+        }
+        break;
+    case QEvent::MouseButtonRelease: {
+        if (m_pressCell < 0 || button != m_pressButton) {
+            return;
+        }
+        // 单击之前先发出尚未发出的拖动
+        flushPointerSignals();
+        auto cell = pressedCell();
+        int cellIndex = m_pressCell;
+        bool dragging = m_pointerDragging;
+        m_pressCell = -1;
+        m_pointerDragging = false;
+        if (dragging || !cell || cellAtPos(pos) != cell) {
+            return;
+        }
+
+        // 槽函数可能翻页或重建网格，发出信号前算好所有结果
+        int row = cellIndex / static_cast<int>(m_cellCols);
+        int col = cellIndex % static_cast<int>(m_cellCols);
+        auto index = static_cast<size_t>(cell->imageIndex);
+        auto scenePos = cellScenePos(*cell, pos);
+        bool inside = false;
+        auto pixel = sourcePixel(*cell, scenePos, &inside);
+        emit imageClicked(row, col, scenePos);
+        if (inside) {
+            emit imagePixelClicked(index, pixel, button);
+        }
+        return;
+    }
+    case QEvent::Leave:
+        if (m_pressCell >= 0) {
+            return;
+        }
+        m_hoverIndex = -1;
+        m_hoverPending = true;
+        break;
+    default:
+        return;
+    }
+
+    // 悬停和拖动在下一帧只发出最新的状态
+    if (!m_pointerTimer.isActive()) {
+        m_pointerTimer.start();
+    }
+}
+
+void QImagesWidget::flushPointerSignals() {
+    m_pointerTimer.stop();
+    if (m_dragPending) {
+        m_dragPending = false;
+        emit imageDragged(static_cast<size_t>(m_pressIndex), m_dragPixel,
+                          m_pressPixel, m_dragButtons);
+    }
+    if (m_hoverPending) {
+        m_hoverPending = false;
+        if (m_hoverIndex < 0) {
+            if (m_shownHoverIndex >= 0) {
+                m_shownHoverIndex = -1;
+                emit imageHoverLeft();
+            }
+        } else if (m_hoverIndex != m_shownHoverIndex ||
+                   m_hoverPixel != m_shownHoverPixel) {
+            m_shownHoverIndex = m_hoverIndex;
+            m_shownHoverPixel = m_hoverPixel;
+            emit imageHovered(static_cast<size_t>(m_hoverIndex), m_hoverPixel);
+        }
+    }
+}
+
+QPointF QImagesWidget::cellScenePos(const Cell &cell, const QPoint &pos) const {
+    // 视图把场景矩形的中心显示在单元中心，并按缩放比例放大
+    auto center = QRectF(cell.view->geometry()).center();
+    return cell.view->sceneRect().center() +
+           (QPointF(pos) - center) / cell.view->zoom();
+}
+
+QPointF QImagesWidget::sourcePixel(Cell &cell, const QPointF &scenePos,
+                                   bool *inside) {
+    if (inside) {
+        *inside = false;
+    }
+    if (!cell.sourceSize.isValid() && cell.imageIndex >= 0) {
+        cell.sourceSize =
+            m_provider->imageSize(static_cast<size_t>(cell.imageIndex));
+    }
+    auto scene = cell.view->sceneSize();
+    if (!cell.sourceSize.isValid() || scene.isEmpty()) {
+        return QPointF();
+    }
+
+    // 图像以场景原点为中心，缩放到场景尺寸显示
+    QPointF pixel(
+        (scenePos.x() + scene.width() / 2) * cell.sourceSize.width() /
+            scene.width(),
+        (scenePos.y() + scene.height() / 2) * cell.sourceSize.height() /
+            scene.height());
+    if (inside) {
+        *inside = pixel.x() >= 0 && pixel.y() >= 0 &&
+                  pixel.x() < cell.sourceSize.width() &&
+                  pixel.y() < cell.sourceSize.height();
+    }
+    return pixel;
+}
+
+QRect QImagesWidget::cellRect(size_t row, size_t col) const {
+    return QRect(static_cast<int>(col * (m_viewWidth + m_horizontalSpacing)),
+                 static_cast<int>(row * (m_viewHeight + m_verticalSpacing)),
+                 static_cast<int>(m_viewWidth), static_cast<int>(m_viewHeight));
+}
+
+void QImagesWidget::onViewportChanged() {
+    if (!m_virtualized && !m_continuousScroll) {
         return;
     }
+    updateVisibleCells();
+    updateMarkers();
+}
 
-    size_t page_offset = m_pageIndex * m_rowNum * m_colNum;
-    for (size_t row = 0; row < m_rowNum; row++) {
-        for (size_t col = 0; col < m_colNum; col++) {
-            size_t index = page_offset + row * m_colNum + col;
+bool QImagesWidget::eventFilter(QObject *watched, QEvent *event) {
+    if (m_scrollArea &&
+        ((watched == m_scrollArea->viewport() &&
+          event->type() == QEvent::Resize) ||
+         (watched == m_contentWidget && event->type() == QEvent::Move))) {
+        onViewportChanged();
+    }
 
-            auto itemView =
-                this->itemView(static_cast<int>(row), static_cast<int>(col));
-            if (!itemView) {
-                continue;
+    switch (event->type()) {
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseMove:
+    case QEvent::MouseButtonRelease:
+    case QEvent::Leave: {
+        // WidgetBackend下视图未处理的事件还会传到画布，画布只在BatchedBackend下处理
+        QWidget *source = nullptr;
+        if (watched == m_contentWidget) {
+            if (m_renderBackend == BatchedBackend) {
+                source = m_contentWidget;
             }
-
-            if (index >= static_cast<size_t>(m_images.size())) {
-                itemView->setImage(QImage());
-                continue;
+        } else if (auto view = qobject_cast<QImagesWidgetItemView *>(
+                       watched->parent())) {
+            if (view->viewport() == watched &&
+                view->parentWidget() == m_contentWidget) {
+                source = view->viewport();
             }
+        }
+        if (!source) {
+            break;
+        }
+        if (event->type() == QEvent::Leave) {
+            handlePointerEvent(QEvent::Leave, QPoint(), Qt::NoButton,
+                               Qt::NoButton);
+        } else {
+            auto mouseEvent = static_cast<QMouseEvent *>(event);
+            auto pos = source == m_contentWidget
+                           ? mouseEvent->pos()
+                           : source->mapTo(m_contentWidget, mouseEvent->pos());
+            handlePointerEvent(event->type(), pos, mouseEvent->button(),
+                               mouseEvent->buttons());
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return QWidget::eventFilter(watched, event);
+}
+
+void QImagesWidget::setupLayout() {
+    auto mainLayout = new QVBoxLayout(this);
+    mainLayout->setContentsMargins(0, 0, 0, 0);
+    setLayout(mainLayout);
+
+    m_scrollArea = new QScrollArea(this);
+    m_scrollArea->setWidgetResizable(true);
+    m_scrollArea->setHorizontalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+    m_scrollArea->setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+    m_scrollArea->setAlignment(Qt::AlignCenter);
+
+    // 单元视图由updateGrid按网格位置直接摆放，以便虚拟化时只创建部分视图
+    m_contentWidget = new QImagesWidgetCanvas(this, m_scrollArea);
+
+    m_scrollArea->setWidget(m_contentWidget);
+    // 滚动或居中都会移动内容控件，视口尺寸变化则改变可见范围
+    m_scrollArea->viewport()->installEventFilter(this);
+    m_contentWidget->installEventFilter(this);
+
+    mainLayout->addWidget(m_scrollArea);
+}
+
+QPixmap QImagesWidget::scaledPixmap(size_t index, const QSize &size,
+                                    QImagesPixmapKey *key,
+                                    QImage *windowSource) {
+    // 先按当前窗宽窗位查找，再查找与窗宽窗位无关的结果
+    QImagesPixmapKey lookupKey{index, size, m_transformationMode,
+                               m_windowSerial};
+    auto cached = m_pixmapCache.object(lookupKey);
+    if (!cached) {
+        lookupKey.window = 0;
+        cached = m_pixmapCache.object(lookupKey);
+    }
+
+    // 映射前的16位结果与窗宽窗位无关，命中时一并返回，之后调整窗宽窗位不必重新缩放
+    QImagesPixmapKey sourceKey{index, size, m_transformationMode};
+    auto cachedSource = m_windowSourceCache.object(sourceKey);
+    QImage scaled16 = cachedSource ? *cachedSource : QImage();
+    if (cached) {
+        ++m_pixmapCacheHits;
+        if (key) {
+            *key = lookupKey;
+        }
+        if (windowSource) {
+            *windowSource = lookupKey.window != 0 ? scaled16 : QImage();
+        }
+        return *cached;
+    }
 
-            // 缩放图像并设置到自定义视图
-            auto image = m_images[static_cast<int>(index)];
-            image = image.scaled(static_cast<int>(currentSceneWidth),
-                                 static_cast<int>(currentSceneHeight),
-                                 Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-            auto pixmapItem = itemView->setImage(image);
+    QPixmap pixmap;
+    if (!scaled16.isNull()) {
+        // 只缓存了映射前的结果，按当前窗宽窗位重新映射即可
+        ++m_pixmapCacheHits;
+        pixmap = uploadPixmap(applyWindowLut(scaled16, m_windowLut));
+    } else {
+        ++m_pixmapCacheMisses;
+
+        // 仍在排队的预取任务由这里同步完成，不再重复缩放
+        auto pending = m_prefetchPending.find(sourceKey);
+        if (pending != m_prefetchPending.end() &&
+            pending.value()->testAndSetOrdered(PrefetchQueued,
+                                               PrefetchDropped)) {
+            m_prefetchPending.erase(pending);
+        }
 
-            // 设置场景偏移
-            auto [hOffset, vOffset] =
-                sceneOffset(static_cast<int>(row), static_cast<int>(col));
-            itemView->setSceneRect(hOffset, vOffset,
-                                   static_cast<qreal>(currentSceneWidth),
-                                   static_cast<qreal>(currentSceneHeight));
+        auto image = renderImage(index, size, renderOptions(), &scaled16);
+        pixmap = uploadPixmap(image);
+        if (!scaled16.isNull()) {
+            insertWindowSource(sourceKey, scaled16);
         }
     }
+    lookupKey.window = scaled16.isNull() ? 0 : m_windowSerial;
+    insertPixmap(lookupKey, pixmap);
+
+    if (key) {
+        *key = lookupKey;
+    }
+    if (windowSource) {
+        *windowSource = scaled16;
+    }
+    return pixmap;
 }
 
-size_t QImagesWidget::pageCount() const {
-    if (m_images.isEmpty() || m_rowNum == 0 || m_colNum == 0) {
-        return 0;
+void QImagesWidget::insertPixmap(const QImagesPixmapKey &key,
+                                 const QPixmap &pixmap) {
+    // 以KB为单位计算缓存开销
+    auto cost = static_cast<int>(qMax<qint64>(1, pixmapBytes(pixmap) / 1024));
+    m_pixmapCache.insert(key, new QPixmap(pixmap), cost);
+}
+
+void QImagesWidget::insertWindowSource(const QImagesPixmapKey &key,
+                                       const QImage &image) {
+    auto cost = static_cast<int>(qMax<qint64>(1, image.sizeInBytes() / 1024));
+    m_windowSourceCache.insert(key, new QImage(image), cost);
+}
+
+void QImagesWidget::removeCachedPixmaps(size_t index) {
+    const auto keys = m_pixmapCache.keys();
+    for (const auto &key : keys) {
+        if (key.index == index) {
+            m_pixmapCache.remove(key);
+        }
+    }
+    const auto sourceKeys = m_windowSourceCache.keys();
+    for (const auto &key : sourceKeys) {
+        if (key.index == index) {
+            m_windowSourceCache.remove(key);
+        }
+    }
+}
+
+QImagesWidget::RenderOptions QImagesWidget::renderOptions() const {
+    return RenderOptions{m_transformationMode, m_resampleFilter, m_windowLut,
+                         m_provider,
+                         m_mipmapEnabled ? &m_mipmapCache : nullptr};
+}
+
+QImage QImagesWidget::scaleImage(const QImage &image, const QSize &size,
+                                 const RenderOptions &options) {
+    QIMAGES_PROFILE_SCOPE(ScaleImage);
+    QIMAGES_PROFILE_COUNT(ImagesScaled, 1);
+    if (options.mode == Qt::FastTransformation) {
+        return image.scaled(size, Qt::IgnoreAspectRatio, options.mode);
+    }
+    // 平滑缩放使用自带的重采样引擎，16位灰度图像保持16位精度
+    return QImagesResampler::resample(image, size, options.filter);
+}
+
+QImage QImagesWidget::renderImage(size_t index, const QSize &size,
+                                  const RenderOptions &options,
+                                  QImage *windowSource) {
+    auto provider = options.provider;
+    QImage image;
+    if (options.mipmaps && options.mode == Qt::SmoothTransformation) {
+        // 从不小于目标尺寸的最小一级缩放，金字塔缺少的级别在此生成
+        image = options.mipmaps->levelFor(
+            index, size, [provider, index]() { return provider->image(index); });
+    } else {
+        image = provider->image(index);
+    }
+
+    auto scaled = scaleImage(image, size, options);
+    if (scaled.format() != QImage::Format_Grayscale16) {
+        return scaled;
+    }
+
+    if (windowSource) {
+        *windowSource = scaled;
+    }
+    return applyWindowLut(scaled, options.windowLut);
+}
+
+QImage QImagesWidget::sourceImage(size_t index, const RenderOptions &options) {
+    auto image = options.provider->image(index);
+    if (image.format() != QImage::Format_Grayscale16) {
+        return image;
+    }
+    return applyWindowLut(image, options.windowLut);
+}
+
+QImage QImagesWidget::applyWindowLut(const QImage &image,
+                                     const QVector<uchar> &windowLut) {
+    QImage result(image.size(), QImage::Format_Grayscale8);
+    if (result.isNull() || windowLut.size() != 65536) {
+        return result;
+    }
+
+    auto lut = windowLut.constData();
+    int width = image.width();
+    for (int y = 0; y < image.height(); y++) {
+        auto src = reinterpret_cast<const quint16 *>(image.constScanLine(y));
+        auto dst = result.scanLine(y);
+        for (int x = 0; x < width; x++) {
+            dst[x] = lut[src[x]];
+        }
+    }
+    return result;
+}
+
+void QImagesWidget::updateWindowLut() {
+    // DICOM线性窗宽窗位映射
+    m_windowLut.resize(65536);
+    double lower = m_windowCenter - 0.5 - (m_windowWidth - 1) / 2;
+    double upper = m_windowCenter - 0.5 + (m_windowWidth - 1) / 2;
+    double range = qMax(1.0, m_windowWidth - 1);
+    for (int value = 0; value < 65536; value++) {
+        if (value <= lower) {
+            m_windowLut[value] = 0;
+        } else if (value > upper) {
+            m_windowLut[value] = 255;
+        } else {
+            double mapped =
+                ((value - (m_windowCenter - 0.5)) / range + 0.5) * 255.0;
+            m_windowLut[value] =
+                static_cast<uchar>(qBound(0.0, mapped + 0.5, 255.0));
+        }
     }
+}
 
+void QImagesWidget::schedulePrefetch(const QSize &size) {
     size_t imagesPerPage = m_rowNum * m_colNum;
-    return (m_images.size() + imagesPerPage - 1) / imagesPerPage; // 向上取整
+    size_t pages = pageCount();
+    if (m_prefetchDepth <= 0 || imagesPerPage == 0 || pages <= 1) {
+        trimPrefetch({});
+        return;
+    }
+
+    // 按距离由近到远排列的图像索引区间[first, last)。分页时为N+1, N-1, N+2, N-2...页；
+    // 连续滚动时为可见范围下方和上方依次相邻的一页行
+    QVector<QPair<size_t, size_t>> ranges;
+    size_t count = imageCount();
+    for (int distance = 1; distance <= m_prefetchDepth; distance++) {
+        for (int direction : {1, -1}) {
+            qint64 first = 0;
+            if (m_continuousScroll) {
+                first = direction > 0
+                            ? static_cast<qint64>(m_rangeRowEnd * m_colNum +
+                                                  (distance - 1) * imagesPerPage)
+                            : static_cast<qint64>(m_rangeRowBegin * m_colNum) -
+                                  distance * static_cast<qint64>(imagesPerPage);
+            } else {
+                auto page =
+                    static_cast<qint64>(m_pageIndex) + direction * distance;
+                first = page * static_cast<qint64>(imagesPerPage);
+            }
+            qint64 last = first + static_cast<qint64>(imagesPerPage);
+            first = qMax<qint64>(first, 0);
+            last = qMin<qint64>(last, static_cast<qint64>(count));
+            if (first < last) {
+                ranges.append(qMakePair(static_cast<size_t>(first),
+                                        static_cast<size_t>(last)));
+            }
+        }
+    }
+
+    // 翻页后仍在新窗口内的任务保留在队列中，窗口外的任务被撤销
+    QSet<QImagesPixmapKey> wanted;
+    for (const auto &range : ranges) {
+        for (size_t index = range.first; index < range.second; index++) {
+            wanted.insert(QImagesPixmapKey{index, size, m_transformationMode});
+        }
+    }
+    trimPrefetch(wanted);
+
+    auto options = renderOptions();
+
+    for (const auto &range : ranges) {
+        for (size_t index = range.first; index < range.second; index++) {
+            // 等待中的任务以window为0的键登记
+            QImagesPixmapKey key{index, size, m_transformationMode};
+            QImagesPixmapKey windowedKey = key;
+            windowedKey.window = m_windowSerial;
+            if (m_pixmapCache.contains(key) ||
+                m_pixmapCache.contains(windowedKey) ||
+                m_windowSourceCache.contains(key) ||
+                m_prefetchPending.contains(key)) {
+                continue;
+            }
+            auto state = QSharedPointer<QAtomicInt>::create(PrefetchQueued);
+            m_prefetchPending.insert(key, state);
+
+            m_prefetchPool.start([this, key, state, options]() {
+                if (!state->testAndSetOrdered(PrefetchQueued, PrefetchRunning)) {
+                    return;
+                }
+                // 数据源的读取和解码也在工作线程中完成
+                QImage scaled16;
+                auto image =
+                    renderImage(key.index, key.size, options, &scaled16);
+                // QPixmap只能在GUI线程中创建，将结果交回主线程
+                QMetaObject::invokeMethod(
+                    this,
+                    [this, key, state, image, scaled16]() {
+                        finishPrefetch(key, state, image, scaled16);
+                    },
+                    Qt::QueuedConnection);
+            });
+        }
+    }
 }
 
-QGraphicsScene *QImagesWidget::scene(int row, int col) const {
-    auto v = view(row, col);
-    return v ? v->scene() : nullptr;
+void QImagesWidget::trimPrefetch(const QSet<QImagesPixmapKey> &wanted) {
+    for (auto it = m_prefetchPending.begin(); it != m_prefetchPending.end();) {
+        // 已开始运行的任务无法中断，保留登记以便接收结果
+        if (!wanted.contains(it.key()) &&
+            it.value()->testAndSetOrdered(PrefetchQueued, PrefetchDropped)) {
+            it = m_prefetchPending.erase(it);
+        } else {
+            ++it;
+        }
+    }
 }
 
-const QImage &QImagesWidget::imageAt(size_t index) const {
-    static QImage emptyImage;
-    if (index >= m_images.size()) {
-        return emptyImage;
+void QImagesWidget::cancelPrefetch() {
+    for (const auto &state : m_prefetchPending) {
+        state->storeRelease(PrefetchDropped);
     }
-    return m_images[index];
+    m_prefetchPending.clear();
 }
 
-const QImage &QImagesWidget::imageAt(int row, int col) const {
-    if (!isValidIndex(row, col)) {
-        static QImage emptyImage;
-        return emptyImage;
+void QImagesWidget::cancelCineFrames() {
+    m_cineGeneration.ref();
+    for (auto &slot : m_cineBuffer) {
+        slot = CineFrame();
+    }
+    m_cineImages.clear();
+    m_cinePending.clear();
+}
+
+void QImagesWidget::finishPrefetch(const QImagesPixmapKey &key,
+                                   const QSharedPointer<QAtomicInt> &state,
+                                   const QImage &image,
+                                   const QImage &windowSource) {
+    // 任务被取消后键可能已重新登记，只接收仍然登记着本任务的结果
+    auto pending = m_prefetchPending.find(key);
+    if (pending == m_prefetchPending.end() || pending.value() != state) {
+        return;
     }
+    m_prefetchPending.erase(pending);
 
-    size_t page_offset = m_pageIndex * m_rowNum * m_colNum;
-    size_t index = page_offset + row * m_colNum + col;
-    return imageAt(index);
+    if (!windowSource.isNull() && !m_windowSourceCache.contains(key)) {
+        insertWindowSource(key, windowSource);
+    }
+
+    // 窗宽窗位变化会取消预取，因此这里的序号与提交时一致
+    auto cacheKey = key;
+    cacheKey.window = windowSource.isNull() ? 0 : m_windowSerial;
+    if (image.isNull() || m_pixmapCache.contains(cacheKey)) {
+        return;
+    }
+    insertPixmap(cacheKey, uploadPixmap(image));
 }
 
-void QImagesWidget::updateGrid() {
-    if (!m_enableUpdate) {
+void QImagesWidget::onCineTick() {
+    size_t frames = cineFrameCount();
+    if (frames == 0) {
+        pause();
+        return;
+    }
+
+    // 按经过的时间计算应当前进的帧数，超过一帧的部分即为丢弃的帧
+    qint64 now = m_cineClock.elapsed();
+    auto due = static_cast<qint64>(now * m_cineFps / 1000.0);
+    qint64 steps = due - m_cineTicks;
+    if (steps <= 0) {
         return;
     }
+    m_cineTicks = due;
+
+    // 单次播放在末尾停止时只计算实际前进的帧
+    size_t frame = cineFrame();
+    bool stopped = false;
+    qint64 advanced = 0;
+    for (qint64 step = 0; step < steps; step++) {
+        frame = nextCineFrame(frame, m_cineDirection, &stopped);
+        if (stopped) {
+            break;
+        }
+        advanced++;
+    }
+    if (advanced > 1) {
+        m_cineStats.framesDropped += static_cast<quint64>(advanced - 1);
+    }
 
-    auto grid = this->gridLayout();
+    // 预渲染完成的图像放入像素图缓存，updateMarkers()会直接命中
+    const auto &slot =
+        m_cineBuffer[static_cast<int>(frame % m_cineBuffer.size())];
+    bool missed = slot.frame != static_cast<qint64>(frame);
+    if (!missed) {
+        for (const auto &key : slot.keys) {
+            auto windowedKey = key;
+            windowedKey.window = m_windowSerial;
+            if (m_pixmapCache.contains(key) ||
+                m_pixmapCache.contains(windowedKey) ||
+                m_windowSourceCache.contains(key)) {
+                continue;
+            }
+            auto rendered = m_cineImages.constFind(key);
+            if (rendered == m_cineImages.cend()) {
+                missed = true;
+                continue;
+            }
 
-    while (QLayoutItem *item = grid->takeAt(0)) {
-        if (QWidget *widget = item->widget()) {
-            widget->deleteLater();
+            auto cacheKey = rendered->cacheKey;
+            auto image = rendered->image;
+            if (!rendered->windowSource.isNull()) {
+                insertWindowSource(key, rendered->windowSource);
+                // 渲染后窗宽窗位已变化，按当前查找表重新映射
+                if (cacheKey.window != m_windowSerial) {
+                    image = applyWindowLut(rendered->windowSource, m_windowLut);
+                    cacheKey.window = m_windowSerial;
+                }
+            }
+            insertPixmap(cacheKey, uploadPixmap(image));
         }
-        delete item;
+    }
+    if (missed) {
+        m_cineStats.bufferMisses++;
     }
 
-    // Use getters to ensure correct scene dimensions are used
-    size_t currentSceneWidth = this->sceneWidth();
-    size_t currentSceneHeight = this->sceneHeight();
+    // 已显示的帧和被跳过的帧都不再需要
+    showCineFrame(frame);
+    trimCineFrames();
+    m_cineStats.framesShown++;
 
-    if (m_rowNum == 0 || m_colNum == 0 || currentSceneWidth == 0 ||
-        currentSceneHeight == 0) {
-        m_contentWidget->setFixedSize(0, 0);
+    m_cineShownTimes.append(now);
+    while (!m_cineShownTimes.isEmpty() && m_cineShownTimes.first() <= now - 1000) {
+        m_cineShownTimes.removeFirst();
+    }
+    m_cineStats.fps = now >= 1000
+                          ? m_cineShownTimes.size()
+                          : m_cineShownTimes.size() * 1000.0 / qMax<qint64>(1, now);
+
+    emit cineFrameChanged(frame);
+
+    if (stopped) {
+        pause();
+        return;
+    }
+    scheduleCineFrames();
+}
+
+size_t QImagesWidget::nextCineFrame(size_t frame, int &direction,
+                                    bool *stopped) const {
+    size_t frames = cineFrameCount();
+    auto next = static_cast<qint64>(frame) + direction;
+    if (next >= 0 && next < static_cast<qint64>(frames)) {
+        return static_cast<size_t>(next);
+    }
+
+    switch (m_cineLoopMode) {
+    case Loop:
+        return direction > 0 ? 0 : frames - 1;
+    case Bounce:
+        if (frames <= 1) {
+            return frame;
+        }
+        direction = -direction;
+        return static_cast<size_t>(static_cast<qint64>(frame) + direction);
+    case PlayOnce:
+    default:
+        if (stopped) {
+            *stopped = true;
+        }
+        return frame;
+    }
+}
+
+size_t QImagesWidget::cineFrameFirstImage(size_t frame) const {
+    return m_cineStep == PageStep ? frame * m_rowNum * m_colNum : frame;
+}
+
+void QImagesWidget::showCineFrame(size_t frame) {
+    // 直接切换位置，不取消预渲染任务
+    size_t imagesPerPage = m_rowNum * m_colNum;
+    if (imagesPerPage == 0) {
         return;
     }
+    size_t first = cineFrameFirstImage(frame);
+    m_pageIndex = first / imagesPerPage;
+    m_imageShift = first % imagesPerPage;
+    updateMarkers();
+}
+
+QVector<size_t> QImagesWidget::upcomingCineFrames() const {
+    QVector<size_t> frames;
+    if (cineFrameCount() == 0) {
+        return frames;
+    }
 
-    for (size_t row = 0; row < m_rowNum; row++) {
-        for (size_t col = 0; col < m_colNum; col++) {
-            auto [hOffset, vOffset] =
-                sceneOffset(static_cast<int>(row), static_cast<int>(col));
+    // 模拟播放方向依次找出接下来的帧
+    size_t frame = cineFrame();
+    int direction = m_cineDirection;
+    bool stopped = false;
+    for (int ahead = 0; ahead < m_cineBuffer.size(); ahead++) {
+        frame = nextCineFrame(frame, direction, &stopped);
+        if (stopped) {
+            break;
+        }
+        frames.append(frame);
+    }
+    return frames;
+}
 
-            auto view = new QImagesWidgetItemView(m_contentWidget);
-            view->setSceneRect(hOffset, vOffset,
-                               static_cast<qreal>(currentSceneWidth),
-                               static_cast<qreal>(currentSceneHeight));
+void QImagesWidget::scheduleCineFrames() {
+    size_t imagesPerPage = m_rowNum * m_colNum;
+    if (imagesPerPage == 0 || m_cineBuffer.isEmpty() || sceneWidth() == 0 ||
+        sceneHeight() == 0) {
+        return;
+    }
 
-            view->setFixedSize(static_cast<int>(m_viewWidth),
-                               static_cast<int>(m_viewHeight));
-            grid->addWidget(view, static_cast<int>(row), static_cast<int>(col));
+    QSize size = renderSize();
+    int generation = m_cineGeneration.loadAcquire();
+    auto options = renderOptions();
+    quint32 windowSerial = m_windowSerial;
+    size_t count = imageCount();
+
+    const auto frames = upcomingCineFrames();
+    for (size_t frame : frames) {
+        auto &slot = m_cineBuffer[static_cast<int>(frame % m_cineBuffer.size())];
+        if (slot.frame == static_cast<qint64>(frame)) {
+            continue;
+        }
+        slot = CineFrame();
+        slot.frame = static_cast<qint64>(frame);
+
+        // ImageStep时相邻帧大部分图像相同，已缓存、已渲染或正在渲染的图像不再提交
+        QVector<QImagesPixmapKey> keys;
+        size_t first = cineFrameFirstImage(frame);
+        size_t last = qMin(first + imagesPerPage, count);
+        for (size_t index = first; index < last; index++) {
+            QImagesPixmapKey key{index, size, m_transformationMode};
+            slot.keys.append(key);
+
+            QImagesPixmapKey windowedKey = key;
+            windowedKey.window = windowSerial;
+            if (m_pixmapCache.contains(key) ||
+                m_pixmapCache.contains(windowedKey) ||
+                m_windowSourceCache.contains(key) || m_cineImages.contains(key) ||
+                m_cinePending.contains(key)) {
+                continue;
+            }
+            m_cinePending.insert(key);
+            keys.append(key);
         }
+        if (keys.isEmpty()) {
+            continue;
+        }
+
+        m_prefetchPool.start([this, keys, generation, options, windowSerial]() {
+            if (m_cineGeneration.loadAcquire() != generation) {
+                return;
+            }
+            QElapsedTimer timer;
+            timer.start();
+            CineImages images;
+            for (const auto &key : keys) {
+                CineImage rendered;
+                rendered.image = renderImage(key.index, key.size, options,
+                                             &rendered.windowSource);
+                if (rendered.image.isNull()) {
+                    continue;
+                }
+                rendered.cacheKey = key;
+                rendered.cacheKey.window =
+                    rendered.windowSource.isNull() ? 0 : windowSerial;
+                images.append(rendered);
+            }
+            double latencyMs = timer.nsecsElapsed() / 1e6;
+            QMetaObject::invokeMethod(
+                this,
+                [this, keys, generation, images, latencyMs]() {
+                    finishCineFrame(keys, generation, images, latencyMs);
+                },
+                Qt::QueuedConnection);
+        });
     }
+}
 
-    int totalViewsWidth = 0;
-    int totalViewsHeight = 0;
+void QImagesWidget::finishCineFrame(const QVector<QImagesPixmapKey> &keys,
+                                    int generation, const CineImages &images,
+                                    double latencyMs) {
+    // 取消时登记已一并清空，旧任务的结果直接丢弃
+    if (generation != m_cineGeneration.loadAcquire()) {
+        return;
+    }
+    for (const auto &key : keys) {
+        m_cinePending.remove(key);
+    }
 
-    if (m_colNum > 0) {
-        totalViewsWidth = static_cast<int>(m_colNum * m_viewWidth);
-        if (m_colNum > 1) {
-            totalViewsWidth +=
-                static_cast<int>((m_colNum - 1) * grid->horizontalSpacing());
+    // 渲染期间播放位置可能已越过这些帧，只保留仍有槽位需要的图像
+    QSet<QImagesPixmapKey> needed;
+    for (const auto &slot : m_cineBuffer) {
+        for (const auto &key : slot.keys) {
+            needed.insert(key);
         }
     }
-    if (m_rowNum > 0) {
-        totalViewsHeight = static_cast<int>(m_rowNum * m_viewHeight);
-        if (m_rowNum > 1) {
-            totalViewsHeight +=
-                static_cast<int>((m_rowNum - 1) * grid->verticalSpacing());
+    for (const auto &rendered : images) {
+        auto key = rendered.cacheKey;
+        key.window = 0;
+        if (needed.contains(key)) {
+            m_cineImages.insert(key, rendered);
         }
     }
 
-    m_contentWidget->setFixedSize(totalViewsWidth, totalViewsHeight);
+    m_cineLatencyCount++;
+    m_cineStats.averageLatencyMs +=
+        (latencyMs - m_cineStats.averageLatencyMs) / m_cineLatencyCount;
+    m_cineStats.maxLatencyMs = qMax(m_cineStats.maxLatencyMs, latencyMs);
 }
 
-bool QImagesWidget::eventFilter(QObject *watched, QEvent *event) {
-    return QWidget::eventFilter(watched, event);
+void QImagesWidget::trimCineFrames() {
+    const auto frames = upcomingCineFrames();
+    QSet<QImagesPixmapKey> needed;
+    for (auto &slot : m_cineBuffer) {
+        if (slot.frame < 0 ||
+            !frames.contains(static_cast<size_t>(slot.frame))) {
+            slot = CineFrame();
+            continue;
+        }
+        for (const auto &key : slot.keys) {
+            needed.insert(key);
+        }
+    }
+
+    for (auto it = m_cineImages.begin(); it != m_cineImages.end();) {
+        if (needed.contains(it.key())) {
+            ++it;
+        } else {
+            it = m_cineImages.erase(it);
+        }
+    }
 }
 
-void QImagesWidget::setupLayout() {
-    auto mainLayout = new QVBoxLayout(this);
-    mainLayout->setContentsMargins(0, 0, 0, 0);
-    setLayout(mainLayout);
+void QImagesWidget::submitExportJobs() {
+    // 限制同时进行的任务数，内存中最多只有这么多张待编码的图像
+    int maxInFlight = 2 * qMax(1, m_exportPool.maxThreadCount());
+
+    while (m_exportBatch.active && m_exportBatch.inFlight < maxInFlight &&
+           m_exportBatch.next < m_exportBatch.total) {
+        size_t unit = m_exportBatch.next++;
+        m_exportBatch.inFlight++;
+
+        const auto batch = m_exportBatch;
+        m_exportPool.start([this, batch, unit]() {
+            QString errorString;
+            bool ok = false;
+            if (batch.cancelled->loadAcquire()) {
+                errorString = tr("Export cancelled");
+            } else {
+                auto image = renderExportUnit(batch, unit);
+                auto fileName = QDir(batch.directory)
+                                    .filePath(exportFileName(
+                                        batch.mode, unit, batch.total,
+                                        batch.format));
+                ok = QImagesExporter::write(image, fileName, batch.format, -1,
+                                            batch.cancelled.data(), {},
+                                            &errorString);
+            }
 
-    m_scrollArea = new QScrollArea(this);
-    m_scrollArea->setWidgetResizable(true);
-    m_scrollArea->setHorizontalScrollBarPolicy(Qt::ScrollBarAsNeeded);
-    m_scrollArea->setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
-    m_scrollArea->setAlignment(Qt::AlignCenter);
+            int batchId = batch.id;
+            QMetaObject::invokeMethod(
+                this,
+                [this, batchId, ok, errorString]() {
+                    finishExportJob(batchId, ok, errorString);
+                },
+                Qt::QueuedConnection);
+        });
+    }
+}
 
-    m_contentWidget = new QWidget(m_scrollArea);
+void QImagesWidget::finishExportJob(int batchId, bool ok,
+                                    const QString &errorString) {
+    auto &batch = m_exportBatch;
+    if (batchId != batch.id || !batch.active) {
+        return;
+    }
 
-    m_grid = new QGridLayout(m_contentWidget);
-    m_grid->setSpacing(1);
-    m_grid->setContentsMargins(0, 0, 0, 0);
+    batch.inFlight--;
+    batch.done++;
+    if (ok) {
+        batch.written++;
+    } else if (batch.errorString.isEmpty()) {
+        batch.errorString = errorString;
+    }
 
-    m_scrollArea->setWidget(m_contentWidget);
+    double seconds = qMax<qint64>(1, batch.clock.elapsed()) / 1000.0;
+    emit exportAllProgress(batch.done, batch.total, batch.done / seconds);
 
-    mainLayout->addWidget(m_scrollArea);
+    if (batch.done < batch.total) {
+        submitExportJobs();
+        return;
+    }
+
+    batch.active = false;
+    batch.overlays.clear();
+    batch.shapes.clear();
+    emit exportAllFinished(batch.written == batch.total, batch.written,
+                           batch.errorString);
 }
 
-QGridLayout *QImagesWidget::gridLayout() const { return m_grid; }
+QImage QImagesWidget::renderExportUnit(const ExportBatch &batch,
+                                       size_t unit) {
+    QIMAGES_PROFILE_SCOPE(Render);
+    // 按图像导出时写出全分辨率的原图
+    if (batch.mode == ExportPerImage) {
+        auto overlay = batch.overlays.constFind(unit);
+        if (overlay != batch.overlays.constEnd()) {
+            return overlay.value();
+        }
+        auto image = sourceImage(unit, batch.options);
+        auto shapes = batch.shapes.constFind(unit);
+        if (shapes == batch.shapes.constEnd() || image.isNull()) {
+            return image;
+        }
+
+        // 与grabImage()相同，场景中的图像矩形映射到原图分辨率
+        image = image.convertToFormat(image.hasAlphaChannel()
+                                          ? QImage::Format_ARGB32_Premultiplied
+                                          : QImage::Format_RGB32);
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing);
+        const auto &sceneSize = batch.layout.sceneSize;
+        painter.scale(image.width() / sceneSize.width(),
+                      image.height() / sceneSize.height());
+        painter.translate(sceneSize.width() / 2, sceneSize.height() / 2);
+        QImagesOverlayModel::paintShapes(&painter, shapes.value());
+        painter.end();
+        return image;
+    }
+
+    // 与renderPage()共用拼图实现，空单元保持黑色
+    QImage page(batch.pageSize, QImage::Format_RGB32);
+    if (page.isNull()) {
+        return page;
+    }
+    page.fill(Qt::black);
+
+    auto overlays = [&batch](QPainter *painter, size_t index,
+                             const QRectF &cell, const QRectF &scene) {
+        auto layer = batch.overlays.constFind(index);
+        if (layer != batch.overlays.constEnd()) {
+            painter->drawImage(cell, layer.value());
+            return;
+        }
+        auto shapes = batch.shapes.constFind(index);
+        if (shapes != batch.shapes.constEnd()) {
+            painter->translate(cell.topLeft() - scene.topLeft());
+            QImagesOverlayModel::paintShapes(painter, shapes.value());
+        }
+    };
+
+    QPainter painter(&page);
+    paintPageRegion(&painter, batch.layout, unit, 1.0, page.rect(),
+                    batch.options, overlays, batch.cancelled.data());
+    painter.end();
+    return page;
+}
 
 bool QImagesWidget::isValidIndex(int row, int col) const {
-    return (row >= 0 && row < static_cast<int>(m_rowNum) && col >= 0 &&
+    return (row >= 0 && row < static_cast<int>(gridRows()) && col >= 0 &&
             col < static_cast<int>(m_colNum));
 }
+
+size_t QImagesWidget::gridRows() const {
+    if (!m_continuousScroll) {
+        return m_rowNum;
+    }
+    if (m_colNum == 0) {
+        return 0;
+    }
+    return (imageCount() + m_colNum - 1) / m_colNum;
+}
+
+size_t QImagesWidget::firstImageIndex() const {
+    return m_continuousScroll ? 0
+                              : m_pageIndex * m_rowNum * m_colNum + m_imageShift;
+}
+
+const QImagesWidget::Cell *QImagesWidget::cellAt(int row, int col) const {
+    // 禁用更新期间m_cells可能仍是旧布局，需按其实际尺寸检查
+    if (!isValidIndex(row, col) || row >= static_cast<int>(m_cellRows) ||
+        col >= static_cast<int>(m_cellCols)) {
+        return nullptr;
+    }
+    return &m_cells[static_cast<int>(row * m_cellCols + col)];
+}
+
+QImagesWidgetItemView *QImagesWidget::acquireView() {
+    if (!m_viewPool.isEmpty()) {
+        return m_viewPool.takeLast();
+    }
+    QIMAGES_PROFILE_COUNT(ViewsAllocated, 1);
+    auto view = new QImagesWidgetItemView(m_contentWidget);
+    view->setExporter(m_exporter);
+    connect(view, &QImagesWidgetItemView::zoomRequested, this,
+            &QImagesWidget::onZoomRequested);
+    connect(view, &QImagesWidgetItemView::panRequested, this,
+            &QImagesWidget::onPanRequested);
+    view->viewport()->installEventFilter(this);
+    return view;
+}
+
+void QImagesWidget::retireView(QImagesWidgetItemView *view) {
+    if (!view) {
+        return;
+    }
+
+    disconnect(view->scene(), &QGraphicsScene::changed, m_contentWidget,
+               &QImagesWidgetCanvas::scheduleRepaint);
+    if (m_renderBackend == BatchedBackend) {
+        m_contentWidget->update(view->geometry());
+    }
+
+    // 复用池容量有限，超出部分直接释放
+    constexpr int maxPooledViews = 64;
+    if (m_viewPool.size() >= maxPooledViews) {
+        view->deleteLater();
+        return;
+    }
+
+    view->setPixmap(QPixmap());
+    view->overlayItem()->setSource(nullptr, -1);
+    view->hide();
+    m_viewPool.append(view);
+}
@@ -1,20 +1,71 @@
 #ifndef QIMAGESWIDGET_H
 #define QIMAGESWIDGET_H
 
-#include <QGridLayout>
+#include <QCache>
+#include <QElapsedTimer>
 #include <QImage>
 #include <QList>
 #include <QWidget>
 #include <QGraphicsItem>
+#include <QHash>
 #include <QGraphicsScene>
 #include <QGraphicsView>
 #include <QPointF>
+#include <QRect>
 #include <QVector>
 #include <QEvent>
 #include <QScrollArea>
 #include <QClipboard>
 #include <QApplication>
+#include <QAtomicInt>
+#include <QPixmap>
+#include <QPointer>
+#include <QSet>
+#include <QSharedPointer>
+#include <QSize>
+#include <QSizeF>
+#include <QThreadPool>
+#include <QTimer>
 
+#include <functional>
+
+#include "qimagesexporter.h"
+#include "qimagesoverlay.h"
+#include "qimagesprofiler.h"
+#include "qimagesprovider.h"
+#include "qimagesresampler.h"
+#include "qimagestiledpixmapitem.h"
+
+/**
+ * @brief 缩放图像缓存的键
+ * @details 同一图像索引在相同场景尺寸和变换模式下的缩放结果相同；
+ *          16位灰度图像的显示结果还取决于窗宽窗位，window为0表示与窗宽窗位无关
+ */
+struct QImagesPixmapKey {
+    size_t index = 0;
+    QSize size;
+    Qt::TransformationMode mode = Qt::SmoothTransformation;
+    quint32 window = 0;
+};
+
+inline bool operator==(const QImagesPixmapKey &a, const QImagesPixmapKey &b) {
+    return a.index == b.index && a.size == b.size && a.mode == b.mode &&
+           a.window == b.window;
+}
+
+inline size_t qHash(const QImagesPixmapKey &key, size_t seed = 0) {
+    auto combine = [&seed](size_t h) {
+        seed ^= h + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    };
+    combine(qHash(static_cast<quint64>(key.index)));
+    combine(qHash(key.size.width()));
+    combine(qHash(key.size.height()));
+    combine(qHash(static_cast<int>(key.mode)));
+    combine(qHash(key.window));
+    return seed;
+}
+
+class QImagesWidgetCanvas;
 
 class QImagesWidgetItemView: public QGraphicsView{
     Q_OBJECT
@@ -28,18 +79,196 @@ public:
      */
     QGraphicsPixmapItem* setImage(const QImage& image);
 
+    /**
+     * @brief 设置已转换好的像素图
+     * @details 与setImage相同，但跳过QImage到QPixmap的转换；传入空像素图会清空场景
+     */
+    QGraphicsPixmapItem* setPixmap(const QPixmap& pixmap);
+
+    /**
+     * @brief 原位替换当前显示的像素图
+     * @details 与setPixmap不同，不会清空场景，调用者添加的图形项保持不变；
+     *          场景中还没有图像时等同于setPixmap
+     */
+    QGraphicsPixmapItem* updatePixmap(const QPixmap& pixmap);
+
+    /**
+     * @brief 当前显示的像素图，没有图像或分块显示时为空
+     */
+    QPixmap pixmap() const;
+
+    /**
+     * @brief 分块设置超大图像
+     * @details 与setImage相同，但不把整张图像转换为一个QPixmap，
+     *          只为可见区域生成当前缩放比例所需分辨率的分块，适用于拼接图等超大图像；
+     *          图像按场景尺寸显示，传入空图像会清空场景
+     */
+    QImagesTiledPixmapItem* setTiledImage(const QImage& image);
+
+    QSizeF sceneSize() const;
+
+    /**
+     * @brief 设置场景尺寸，图像以场景原点为中心放置
+     */
+    void setSceneSize(const QSizeF& size);
+
+    /**
+     * @brief 获取场景偏移量
+     * @return 未缩放、未平移时场景矩形左上角的场景坐标。图像中心位于场景原点，
+     *         图像居中时为(-sceneWidth/2, -sceneHeight/2)
+     */
     QPair<double, double> sceneOffset() const;
+
+    /**
+     * @brief 设置场景偏移量，仅移动可见的场景矩形，不会重新设置图像
+     * @details 偏移量按相对于图像居中位置保存，场景尺寸变化后图像仍保持相同的相对位置
+     * @param hOffset 场景矩形左上角的水平场景坐标
+     * @param vOffset 场景矩形左上角的垂直场景坐标
+     */
     void setSceneOffset(double hOffset, double vOffset);
 
+    /**
+     * @brief 弹出保存/复制图像的右键菜单
+     * @param globalPos 菜单位置（全局坐标）
+     * @return 没有图像时不弹出菜单，返回false
+     */
+    bool showContextMenu(const QPoint& globalPos);
+
+    /**
+     * @brief 获取当前显示的图像
+     * @details 设置了setSourceImage()时返回全分辨率的原图，否则返回显示用的像素图（分块显示时为原图）。
+     *          没有图形项时直接返回该图像，不重新渲染也不转换格式（灰度图保持灰度）；
+     *          有图形项时转换为RGB32或ARGB32_Premultiplied，并将图形项按图像分辨率绘制在上面
+     * @param withObjects 是否包含场景中的图形项，需要在GUI线程中渲染场景
+     * @return 没有图像时返回空图像
+     */
+    QImage grabImage(bool withObjects = false);
+
+    /**
+     * @brief 设置读取全分辨率原图的函数，供保存和复制使用
+     * @details setPixmap()和setImage()会清除该设置
+     */
+    void setSourceImage(const std::function<QImage()>& source);
+
+    /**
+     * @brief 场景中是否有图像以外的图形项
+     * @details 没有关联任何图元的持久图形层不计算在内
+     */
+    bool hasOverlays() const;
+
+    /**
+     * @brief 获取持久图形层，首次调用时创建
+     * @details 该图形项不会被setPixmap()、setTiledImage()等清空场景的操作删除，
+     *          每次重新加入场景时位于图像之上
+     */
+    QImagesOverlayItem* overlayItem();
+
+    /**
+     * @brief 只渲染场景中的图形项，不包含图像本身
+     * @param painter 目标画家
+     * @param target 目标矩形
+     * @param source 场景中的源矩形
+     */
+    void renderOverlays(QPainter* painter, const QRectF& target,
+                        const QRectF& source);
+
+    /**
+     * @brief 在后台保存当前图像，不弹出对话框
+     * @details 只在GUI线程中渲染场景，编码和写文件由exporter()在工作线程中完成，
+     *          结果通过QImagesExporter::finished()报告
+     * @return 任务编号，没有图像时返回-1
+     */
+    int exportImage(const QString& fileName, bool withObjects = false);
+
+    /**
+     * @brief 获取保存图像使用的导出器，未设置时在首次使用时创建
+     */
+    QImagesExporter* exporter();
+
+    /**
+     * @brief 设置保存图像使用的导出器，视图不接管其所有权
+     */
+    void setExporter(QImagesExporter* exporter);
+
+    bool isNavigationEnabled() const;
+
+    /**
+     * @brief 设置是否由滚轮缩放、左键拖动平移
+     * @details 视图本身不改变变换，只发出zoomRequested()和panRequested()，
+     *          由调用者（例如QImagesWidget的联动导航）统一调用setViewTransform()；
+     *          在图形项上按下时鼠标事件仍交给场景
+     */
+    void setNavigationEnabled(bool enable);
+
+    double zoom() const;
+    QPointF pan() const;
+
+    /**
+     * @brief 设置缩放比例和平移量
+     * @param zoom 缩放比例，1表示场景按1:1显示
+     * @param pan 在场景偏移之上的平移量（场景坐标）
+     */
+    void setViewTransform(double zoom, const QPointF& pan);
+
+signals:
+    /**
+     * @brief 请求缩放
+     * @param factor 缩放倍数
+     * @param anchor 鼠标位置相对于可见区域中心的场景坐标，缩放后应保持不动
+     */
+    void zoomRequested(double factor, const QPointF& anchor);
+
+    /**
+     * @brief 请求平移
+     * @param delta 可见区域中心的位移（场景坐标）
+     */
+    void panRequested(const QPointF& delta);
+
 protected:
     void contextMenuEvent(QContextMenuEvent* event) override;
+    void wheelEvent(QWheelEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
 
 private:
     void saveImage(bool withObjects = false);
     void copyImage(bool withObjects = false);
 
-    QImage m_image;
+    void updateSceneRect();
+
+    /**
+     * @brief 将图像放在场景中心，并缩放到场景尺寸
+     */
+    void placePixmapItem();
+
+    /**
+     * @brief 显示图像的图形项，QGraphicsPixmapItem或QImagesTiledPixmapItem
+     */
+    QGraphicsItem* imageItem() const;
+    bool hasImage() const;
+
+    /**
+     * @brief 清空场景，持久图形层先移出，由调用者在加入图像后调用restoreOverlayItem()
+     */
+    void clearScene();
+    void restoreOverlayItem();
+
+    QPixmap m_pixmap;
     QGraphicsScene m_scene;
+    QGraphicsPixmapItem* m_pixmapItem = nullptr;
+    QImagesTiledPixmapItem* m_tiledItem = nullptr;
+    QImagesOverlayItem* m_overlayItem = nullptr;
+    QSizeF m_sceneSize;
+    // 相对于图像居中位置的偏移，sceneOffset()换算为场景矩形左上角
+    QPair<double, double> m_sceneOffset{0.0, 0.0};
+    QPointer<QImagesExporter> m_exporter;
+    std::function<QImage()> m_sourceImage;
+    bool m_navigationEnabled = false;
+    double m_zoom = 1.0;
+    QPointF m_pan;
+    bool m_dragging = false;
+    QPoint m_lastDragPos;
 };
 
 /**
@@ -51,6 +280,69 @@ class QImagesWidget : public QWidget
 {
     Q_OBJECT
 public:
+    /**
+     * @brief 单元的绘制方式
+     */
+    enum RenderBackend {
+        WidgetBackend, ///< 每个单元是一个独立的QGraphicsView
+        BatchedBackend ///< 由一个控件在一次绘制中画出所有单元
+    };
+
+    /**
+     * @brief 电影播放每一帧前进的单位
+     */
+    enum CineStep {
+        PageStep, ///< 每帧翻一页，帧号即页码
+        ImageStep ///< 每帧前进一张图像，帧号为第一个单元的图像索引
+    };
+
+    /**
+     * @brief 电影播放到达首尾帧时的行为
+     */
+    enum CineLoopMode {
+        PlayOnce, ///< 停在最后一帧
+        Loop,     ///< 回到第一帧
+        Bounce    ///< 反向播放
+    };
+
+    /**
+     * @brief 批量导出的文件划分方式
+     */
+    enum ExportMode {
+        ExportPerImage, ///< 每张图像一个文件，image_0000.png…
+        ExportPerPage   ///< 每页拼成一个文件，page_0000.png…
+    };
+
+    /**
+     * @brief 电影播放的统计数据
+     */
+    struct CineStats {
+        double fps = 0.0;          ///< 最近一秒实际显示的帧率
+        quint64 framesShown = 0;   ///< 已显示的帧数
+        quint64 framesDropped = 0; ///< 因来不及显示而跳过的帧数
+        quint64 bufferMisses = 0;  ///< 显示时尚未预渲染完成、需要同步缩放的帧数
+        double averageLatencyMs = 0.0; ///< 工作线程读取并缩放一帧的平均耗时
+        double maxLatencyMs = 0.0;     ///< 工作线程读取并缩放一帧的最大耗时
+    };
+
+    /**
+     * @brief 按类别统计的图像内存占用（字节）
+     * @details 共享同一数据的图像只计算一次，各类别之间不重复
+     */
+    struct MemoryStats {
+        qint64 sourceBytes = 0;       ///< 数据源保存或缓存的原图
+        qint64 mipmapBytes = 0;       ///< 多级缩小金字塔
+        qint64 pixmapCacheBytes = 0;  ///< 缩放像素图缓存
+        qint64 displayBytes = 0;      ///< 正在显示但不在缓存中的像素图
+        qint64 windowSourceBytes = 0; ///< 缓存和可见单元中映射前的16位缩放结果
+        qint64 cineBytes = 0;         ///< 电影播放已预渲染的帧
+
+        qint64 totalBytes() const {
+            return sourceBytes + mipmapBytes + pixmapCacheBytes + displayBytes +
+                   windowSourceBytes + cineBytes;
+        }
+    };
+
     explicit QImagesWidget(QWidget *parent = nullptr);
     ~QImagesWidget() override;
 
@@ -75,7 +367,272 @@ public:
     size_t sceneHeight() const;
     void setSceneHeight(size_t height);
 
+    /**
+     * @brief 设置要显示的图像，会切换回内置的内存数据源并回到第一页
+     */
     void setImages(const QList<QImage>& images);
+
+    bool isCompactStorageEnabled() const;
+
+    /**
+     * @brief 设置内置内存数据源是否以紧凑格式保存图像
+     * @details 灰色的32位或24位图像转换为Grayscale8保存，16位灰度图像保持16位，
+     *          详见QImagesMemoryProvider::setCompactStorage()；只影响之后设置的图像。默认禁用
+     */
+    void setCompactStorageEnabled(bool enable);
+
+    /**
+     * @brief 按类别统计当前的图像内存占用
+     * @details 可见单元只保留正在显示的像素图，离开可见范围或显示其他图像的单元
+     *          会释放缩放结果，视图只通过图像索引读取原图
+     */
+    MemoryStats memoryStats() const;
+
+    /**
+     * @brief 获取当前的图像数据源
+     */
+    QImagesProvider* provider() const;
+
+    /**
+     * @brief 设置图像数据源，图像只在可见或被预取时才会从数据源读取
+     * @details 控件不接管数据源的所有权。工作线程直接调用数据源，数据源必须比控件
+     *          存活得更久，或在销毁前调用setProvider(nullptr)切换回内置的内存数据源，
+     *          该调用会等待正在读取的任务结束。仍在使用时销毁数据源是编程错误，
+     *          调试版本中触发断言，发布版本中记录错误并切换回内存数据源
+     * @param provider 数据源对象
+     */
+    void setProvider(QImagesProvider* provider);
+
+    /**
+     * @brief 替换指定索引的图像
+     * @details 只会重新绘制正在显示该图像的单元，单元中的其他图形项保持不变
+     * @param index 图像索引
+     * @param image 新图像
+     * @return 索引有效时返回true
+     */
+    bool setImage(size_t index, const QImage& image);
+
+    /**
+     * @brief 在末尾追加图像
+     * @details 不会重置当前页，也不会重建网格；只有新图像落在当前页时才会绘制对应单元，
+     *          适用于采集过程中逐张到达的图像
+     * @param image 新图像
+     */
+    void appendImage(const QImage& image);
+
+    /**
+     * @brief 在末尾追加多张图像
+     * @param images 新图像
+     */
+    void appendImages(const QList<QImage>& images);
+
+    /**
+     * @brief 获取图像总数
+     */
+    size_t imageCount() const;
+
+    /**
+     * @brief 将指定索引的图像标记为需要重新绘制
+     * @details 丢弃该图像的缓存结果，并在下一次更新时重新缩放；单元中的其他图形项保持不变
+     * @param index 图像索引
+     */
+    void invalidate(size_t index);
+
+    Qt::TransformationMode transformationMode() const;
+    void setTransformationMode(Qt::TransformationMode mode);
+
+    QImagesResampler::Filter resampleFilter() const;
+
+    /**
+     * @brief 设置平滑缩放时使用的重采样滤波器
+     * @details 仅在变换模式为Qt::SmoothTransformation时生效，默认为Auto
+     * @param filter 滤波器
+     */
+    void setResampleFilter(QImagesResampler::Filter filter);
+
+    bool isMipmapEnabled() const;
+
+    /**
+     * @brief 设置是否为每张图像保存多级缩小金字塔
+     * @details 启用后平滑缩放从不小于目标尺寸的最小一级开始，切换布局或场景尺寸时
+     *          不必再从原图重新缩放；金字塔在首次需要时生成，预取任务会在后台生成。默认禁用
+     * @param enable 是否启用
+     */
+    void setMipmapEnabled(bool enable);
+
+    /**
+     * @brief 获取多级金字塔缓存的容量上限
+     * @return 容量上限（KB）
+     */
+    int mipmapCacheLimit() const;
+    void setMipmapCacheLimit(int kbytes);
+
+    double windowCenter() const;
+    double windowWidth() const;
+
+    /**
+     * @brief 设置16位灰度图像（QImage::Format_Grayscale16）的窗宽窗位
+     * @details 显示时通过查找表将缩放后的16位图像映射为8位，其他格式的图像不受影响；
+     *          可见单元和缓存中已缩放的16位结果只重新映射，不会重新缩放图像。
+     *          默认窗位2048、窗宽4096，即12位数据（0～4095）的完整范围；
+     *          其他位深的数据需要调用者按实际范围设置
+     * @param center 窗位
+     * @param width 窗宽，小于1时按1处理
+     */
+    void setWindowLevel(double center, double width);
+
+    /**
+     * @brief 获取缩放像素图缓存的容量上限
+     * @return 容量上限（KB）
+     */
+    int pixmapCacheLimit() const;
+
+    /**
+     * @brief 设置缩放像素图缓存的容量上限，超出时按最近最少使用淘汰
+     * @details 16位图像映射前的缩放结果另有一个同样上限的缓存
+     * @param kbytes 容量上限（KB），设置为0会禁用缓存
+     */
+    void setPixmapCacheLimit(int kbytes);
+
+    /**
+     * @brief 清空缩放像素图缓存
+     */
+    void clearPixmapCache();
+
+    quint64 pixmapCacheHits() const;
+    quint64 pixmapCacheMisses() const;
+    void resetPixmapCacheStats();
+
+    /**
+     * @brief 获取后台预取的页数
+     * @return 当前页前后各预取的页数
+     */
+    int prefetchDepth() const;
+
+    /**
+     * @brief 设置后台预取的页数
+     * @details 显示第N页时，在工作线程中预先缩放第N±1…N±depth页的图像并放入缓存
+     * @param pages 前后各预取的页数，设置为0会禁用预取
+     */
+    void setPrefetchDepth(int pages);
+
+    /**
+     * @brief 开始电影播放
+     * @details 按cineFps()的帧率逐帧前进，后续帧在工作线程中预渲染到环形缓冲区；
+     *          来不及显示的帧会被跳过并计入统计。连续滚动模式下不可用
+     */
+    void play();
+    void pause();
+    bool isPlaying() const;
+
+    double cineFps() const;
+    void setCineFps(double fps);
+
+    CineLoopMode cineLoopMode() const;
+    void setCineLoopMode(CineLoopMode mode);
+
+    CineStep cineStep() const;
+    void setCineStep(CineStep step);
+
+    /**
+     * @brief 获取当前帧号
+     * @return PageStep时为页码，ImageStep时为第一个单元的图像索引
+     */
+    size_t cineFrame() const;
+
+    /**
+     * @brief 跳转到指定帧
+     * @return 帧号有效时返回true
+     */
+    bool setCineFrame(size_t frame);
+    size_t cineFrameCount() const;
+
+    int cineBufferFrames() const;
+
+    /**
+     * @brief 设置预渲染的帧数，即环形缓冲区的容量
+     * @param frames 帧数，默认为8
+     */
+    void setCineBufferFrames(int frames);
+
+    CineStats cineStats() const;
+    void resetCineStats();
+
+    /**
+     * @brief 获取所有单元共用的导出器，可以连接其finished()信号获取导出结果
+     */
+    QImagesExporter* exporter() const;
+
+    /**
+     * @brief 在后台保存指定单元的图像
+     * @details 与右键菜单的保存相同，只在GUI线程中渲染场景，编码和写文件在工作线程中完成
+     * @param row 行索引
+     * @param col 列索引
+     * @param fileName 目标文件名，格式由扩展名确定
+     * @param withObjects 是否包含单元中的图形项
+     * @return 任务编号，单元没有图像时返回-1
+     */
+    int exportImage(int row, int col, const QString& fileName,
+                    bool withObjects = false);
+
+    /**
+     * @brief 将一页的所有单元按网格布局（包括间距和场景偏移）拼成一张图像
+     * @details 场景偏移取自当前显示该图像的单元，不在任何单元中的图像居中绘制。
+     *          图像直接从数据源读取并缩放到输出分辨率，不需要创建或显示任何控件，
+     *          可以在offscreen平台下使用；当前拥有视图的单元会带上其中的图形项，
+     *          图形项按矢量缩放。需要在GUI线程中调用。
+     *          内部按块缩放，每块只读取所需的原图区域，峰值内存为输出图像加上
+     *          一张原图和一块的中间结果；输出本身过大时使用renderPageRegion()
+     * @param pageIndex 页码，可以不是当前页
+     * @param scale 相对于控件布局尺寸的缩放比例
+     * @return 页码无效或图像过大无法分配时返回空图像
+     */
+    QImage renderPage(size_t pageIndex, qreal scale = 1.0);
+
+    /**
+     * @brief 只渲染一页拼图中的一个矩形区域
+     * @details 用于分块生成很大的拼图，只有与区域相交的单元会被读取，
+     *          每个单元只缩放落在区域内的部分
+     * @param region 拼图坐标系（已按scale缩放）中的区域
+     */
+    QImage renderPageRegion(size_t pageIndex, qreal scale, const QRect& region);
+
+    /**
+     * @brief 按指定比例渲染整页拼图时的图像尺寸
+     */
+    QSize pageImageSize(qreal scale = 1.0) const;
+
+    /**
+     * @brief 在后台把所有图像或所有页面导出到目录
+     * @details 读取、缩放、拼接和编码在线程池中并行完成，同时进行中的任务数量有限，
+     *          内存占用不随图像数量增长。文件名为image_或page_加上补零的索引，
+     *          位数由总数决定，已存在的同名文件会被覆盖。
+     *          ExportPerImage写出全分辨率的原图，ExportPerPage的每页与renderPage()
+     *          的结果相同，包括间距和场景偏移；
+     *          withObjects时当前拥有视图的单元的图形项在开始时于GUI线程中渲染，
+     *          其余图像的图形层图元在开始时复制，由工作线程绘制
+     * @param directory 目标目录，不存在时会被创建
+     * @param format 图像格式，同时作为文件扩展名
+     * @param withObjects 是否包含单元中的图形项
+     * @param mode 按图像还是按页面导出
+     * @return 已有导出在进行、没有图像或无法创建目录时返回false
+     */
+    bool exportAll(const QString& directory, const QByteArray& format = "png",
+                   bool withObjects = false, ExportMode mode = ExportPerImage);
+
+    /**
+     * @brief 取消批量导出，正在写入的文件会被丢弃
+     */
+    void cancelExportAll();
+    bool isExportingAll() const;
+
+    /**
+     * @brief 批量导出使用的文件名
+     * @param unit 图像索引或页码
+     * @param total 图像总数或页数，决定补零的位数
+     */
+    static QString exportFileName(ExportMode mode, size_t unit, size_t total,
+                                  const QByteArray& format);
     
     int horizontalSpacing() const;
     void setHorizontalSpacing(int spacing);
@@ -83,6 +640,81 @@ public:
     int verticalSpacing() const;
     void setVerticalSpacing(int spacing);
 
+    bool isVirtualizationEnabled() const;
+
+    /**
+     * @brief 设置是否只为滚动区域中可见的单元创建视图
+     * @details 启用后只有可见行列（加上margin）中的单元拥有视图并会缩放图像，
+     *          滚动时视图被回收复用；没有视图的单元itemView()/scene()返回nullptr，
+     *          addItem()返回false，离开可见范围的单元中添加的图形项会被清除。默认禁用
+     * @param enable 是否启用
+     */
+    void setVirtualizationEnabled(bool enable);
+
+    int virtualizationMargin() const;
+
+    bool isContinuousScrollEnabled() const;
+
+    /**
+     * @brief 设置是否以连续滚动代替分页
+     * @details 启用后所有图像排成一个colNum列的长网格，在滚动区域中连续滚动；
+     *          只有接近视口的行会创建视图并缩放图像，远离视口的行被回收（与虚拟化相同，
+     *          margin由setVirtualizationMargin()设置）。rowNum()作为一页的行数，
+     *          pageIndex()跟随视口顶部所在的页，setPageIndex()滚动到该页。
+     *          此时单元的行号是整个长网格中的行号。默认禁用
+     * @param enable 是否启用
+     */
+    void setContinuousScrollEnabled(bool enable);
+
+    bool isLinkedNavigationEnabled() const;
+
+    /**
+     * @brief 设置是否启用联动导航
+     * @details 启用后在任一单元中滚轮缩放或左键拖动平移，所有单元使用同一个缩放比例和
+     *          平移量（叠加在各单元自己的场景偏移上）。鼠标移动产生的更新合并为每帧一次；
+     *          缩放停止后按新的比例从原图重新缩放，而不是放大已缩小的像素图。
+     *          禁用时恢复到未缩放的状态
+     * @param enable 是否启用
+     */
+    void setLinkedNavigationEnabled(bool enable);
+
+    double zoom() const;
+
+    /**
+     * @brief 设置所有单元共用的缩放比例
+     * @param zoom 缩放比例，限制在0.25到64之间
+     */
+    void setZoom(double zoom);
+
+    QPointF pan() const;
+
+    /**
+     * @brief 设置所有单元共用的平移量（场景坐标）
+     */
+    void setPan(const QPointF& pan);
+
+    /**
+     * @brief 恢复到未缩放、未平移的状态
+     */
+    void resetNavigation();
+
+    RenderBackend renderBackend() const;
+
+    /**
+     * @brief 设置单元的绘制方式
+     * @details BatchedBackend下单元视图只作为场景的容器而不显示，整页在一次绘制中完成，
+     *          scene()、addItem()、场景偏移和右键菜单保持不变；场景中的图形项只绘制，
+     *          不接收鼠标事件。默认WidgetBackend
+     * @param backend 绘制方式
+     */
+    void setRenderBackend(RenderBackend backend);
+
+    /**
+     * @brief 设置虚拟化时在可见范围之外额外保留的行列数
+     * @param cells 行列数，默认为1
+     */
+    void setVirtualizationMargin(int cells);
+
     bool isUpdateEnabled() const;
 
     /**
@@ -95,16 +727,17 @@ public:
      * @brief 获取指定位置的场景偏移量
      * @param row 行索引
      * @param col 列索引
-     * @return 对应位置的场景偏移量
+     * @return 对应位置场景矩形左上角的场景坐标，图像居中时为(-sceneWidth/2, -sceneHeight/2)
      */
     QPair<double, double> sceneOffset(int row, int col) const;
 
     /**
      * @brief 设置指定位置的场景偏移量
+     * @details 偏移量保存在网格单元中，布局变化后仍然保留；只会移动该单元的视图，不会重新缩放图像
      * @param row 行索引
      * @param col 列索引
-     * @param hOffset 水平偏移
-     * @param vOffset 垂直偏移
+     * @param hOffset 场景矩形左上角的水平场景坐标
+     * @param vOffset 场景矩形左上角的垂直场景坐标
      */
     void setSceneOffset(int row, int col, double hOffset, double vOffset);
 
@@ -141,11 +774,28 @@ public:
      */
     QImagesWidgetItemView* itemView(int row, int col) const;
 
+    /**
+     * @brief 获取按图像索引保存的持久图形层
+     * @details 其中的图元在翻页、滚动和更新图像时不会被删除，显示某张图像的单元
+     *          自动绘制该图像的图元；没有视图的单元在renderPage()中同样会绘制。
+     *          替换整个图像序列时图元保持不变，需要时调用clearAll()
+     */
+    QImagesOverlayModel* overlayModel() const;
+
     /**
      * @brief 更新视图标记
+     * @details 只会重新绘制内容已过期的单元：显示的图像索引、场景尺寸或变换模式发生变化，
+     *          或者图像被invalidate()标记过的单元
      */
     virtual void updateMarkers();
 
+    /**
+     * @brief 获取热点路径的性能统计
+     * @details 需要定义QIMAGESWIDGET_ENABLE_PROFILING编译并调用
+     *          QImagesProfiler::setEnabled(true)，否则所有数据为0
+     */
+    QImagesProfileStats profileStats() const;
+
     /**
      * @brief 获取总页数
      * @return 总页数
@@ -162,21 +812,103 @@ public:
     
     /**
      * @brief 获取指定索引位置的图像
+     * @details 图像按需从数据源读取
      * @param index 线性索引
-     * @return 图像对象
+     * @return 图像对象，索引无效时返回空图像
      */
-    const QImage& imageAt(size_t index) const;
+    QImage imageAt(size_t index) const;
     
     /**
      * @brief 获取指定位置的图像
      * @param row 行索引
      * @param col 列索引
-     * @return 图像对象
+     * @return 图像对象，位置无效时返回空图像
      */
-    const QImage& imageAt(int row, int col) const;
+    QImage imageAt(int row, int col) const;
 
     void updateGrid();
 
+signals:
+    /**
+     * @brief 图像总数发生变化时发出，pageCount()可能随之变化
+     * @param count 新的图像总数
+     */
+    void imageCountChanged(size_t count);
+
+    /**
+     * @brief 在图像上单击（按下和释放在同一单元且没有拖动）
+     * @param row 单元的行索引
+     * @param col 单元的列索引
+     * @param pos 单击位置的场景坐标，原点为图像中心
+     */
+    void imageClicked(int row, int col, const QPointF& pos);
+
+    /**
+     * @brief 与imageClicked()同时发出，只在单击位置落在图像上时发出
+     * @param index 图像索引
+     * @param pixel 原图中的像素坐标，已计入缩放和场景偏移，像素(x, y)覆盖[x, x + 1)
+     * @param button 单击的按键
+     */
+    void imagePixelClicked(size_t index, const QPointF& pixel,
+                           Qt::MouseButton button);
+
+    /**
+     * @brief 鼠标悬停在图像上
+     * @details 鼠标移动事件合并后每帧（约16 ms）最多发出一次，只发出最后的位置，
+     *          与网格大小无关
+     * @param index 图像索引
+     * @param pixel 原图中的像素坐标
+     */
+    void imageHovered(size_t index, const QPointF& pixel);
+
+    /**
+     * @brief 鼠标离开了所有图像，与imageHovered()一样合并发出
+     */
+    void imageHoverLeft();
+
+    /**
+     * @brief 在图像上按下后拖动，与imageHovered()一样合并发出
+     * @details 拖动始终属于按下时的单元，离开该单元后坐标仍按该图像计算，可能超出图像范围
+     * @param index 按下时的图像索引
+     * @param pixel 当前位置在原图中的像素坐标
+     * @param pressPixel 按下位置在原图中的像素坐标
+     * @param buttons 按住的按键
+     */
+    void imageDragged(size_t index, const QPointF& pixel,
+                      const QPointF& pressPixel, Qt::MouseButtons buttons);
+
+    /**
+     * @brief 电影播放显示了新的一帧
+     * @param frame 帧号
+     */
+    void cineFrameChanged(size_t frame);
+
+    /**
+     * @brief 电影播放开始或停止
+     */
+    void cinePlayingChanged(bool playing);
+
+    /**
+     * @brief 批量导出的进度
+     * @param done 已完成的文件数
+     * @param total 文件总数
+     * @param filesPerSecond 开始以来的平均吞吐量
+     */
+    void exportAllProgress(size_t done, size_t total, double filesPerSecond);
+
+    /**
+     * @brief 批量导出结束
+     * @param ok 所有文件都已写入时为true，取消或有文件失败时为false
+     * @param written 成功写入的文件数
+     * @param errorString 第一个错误的原因
+     */
+    void exportAllFinished(bool ok, size_t written, const QString& errorString);
+
+    /**
+     * @brief 启用性能统计时，每次updateMarkers()结束后发出
+     */
+    void profileUpdated(const QImagesProfileStats& stats);
+
 protected:
     bool eventFilter(QObject *watched, QEvent *event) override;
 
@@ -189,17 +921,418 @@ private:
     size_t m_sceneWidth = 256;
     size_t m_sceneHeight = 256;
     bool m_enableUpdate = true;
+    Qt::TransformationMode m_transformationMode = Qt::SmoothTransformation;
+    QImagesResampler::Filter m_resampleFilter = QImagesResampler::Auto;
+    bool m_mipmapEnabled = false;
+    mutable QImagesMipmapCache m_mipmapCache;
 
-    QList<QImage> m_images;
+    // 默认窗宽窗位覆盖12位数据的完整范围，CT、MR等16位图像多为12位有效数据
+    double m_windowCenter = 2048.0;
+    double m_windowWidth = 4096.0;
+    quint32 m_windowSerial = 1;
+    QVector<uchar> m_windowLut;
+
+    QImagesExporter* m_exporter = nullptr;
+    QImagesOverlayModel* m_overlayModel = nullptr;
+    QImagesMemoryProvider* m_memoryProvider = nullptr;
+    QImagesProvider* m_provider = nullptr;
+
+    QCache<QImagesPixmapKey, QPixmap> m_pixmapCache;
+    // 16位图像映射窗宽窗位前的缩放结果，以window为0的键保存
+    QCache<QImagesPixmapKey, QImage> m_windowSourceCache;
+    quint64 m_pixmapCacheHits = 0;
+    quint64 m_pixmapCacheMisses = 0;
+
+    int m_prefetchDepth = 1;
+    QThreadPool m_prefetchPool;
+    // 排队或正在运行的预取任务及其状态，以window为0的键登记
+    QHash<QImagesPixmapKey, QSharedPointer<QAtomicInt>> m_prefetchPending;
+
+    // 电影播放。ImageStep时页内还有m_imageShift张图像的偏移
+    struct CineImage {
+        QImagesPixmapKey cacheKey; ///< 渲染时的缓存键，window为提交时的序号或0
+        QImage image;
+        QImage windowSource;       ///< 16位图像映射前的缩放结果
+    };
+    using CineImages = QVector<CineImage>;
+    struct CineFrame {
+        qint64 frame = -1;
+        QVector<QImagesPixmapKey> keys; ///< 该帧的全部图像，以window为0的键登记
+    };
+    QTimer m_cineTimer;
+    QElapsedTimer m_cineClock;
+    qint64 m_cineTicks = 0;
+    int m_cineDirection = 1;
+    double m_cineFps = 10.0;
+    CineLoopMode m_cineLoopMode = Loop;
+    CineStep m_cineStep = PageStep;
+    size_t m_imageShift = 0;
+    QVector<CineFrame> m_cineBuffer;
+    // 已预渲染、尚未显示的图像，以及已提交尚未完成的图像，均以window为0的键登记。
+    // 相邻帧共用的图像只渲染一次
+    QHash<QImagesPixmapKey, CineImage> m_cineImages;
+    QSet<QImagesPixmapKey> m_cinePending;
+    QAtomicInt m_cineGeneration;
+    QVector<qint64> m_cineShownTimes;
+    CineStats m_cineStats;
+    quint64 m_cineLatencyCount = 0;
+
+    int m_horizontalSpacing = 1;
+    int m_verticalSpacing = 1;
+    bool m_virtualized = false;
+    int m_virtualizationMargin = 1;
+    bool m_continuousScroll = false;
+
+    // 拥有视图的单元范围，行列均为左闭右开
+    size_t m_rangeRowBegin = 0;
+    size_t m_rangeRowEnd = 0;
+    size_t m_rangeColBegin = 0;
+    size_t m_rangeColEnd = 0;
+
+    RenderBackend m_renderBackend = WidgetBackend;
+
+    // 联动导航。m_detailZoom是像素图相对于场景尺寸的分辨率
+    bool m_linkedNavigation = false;
+    double m_zoom = 1.0;
+    QPointF m_pan;
+    double m_detailZoom = 1.0;
+    QTimer m_navigationTimer;
+    QTimer m_detailTimer;
+
+    // 鼠标事件。悬停和拖动先记录最新的状态，由m_pointerTimer在下一帧发出
+    int m_pressCell = -1;
+    qint64 m_pressIndex = -1;
+    QPoint m_pressPos;
+    QPointF m_pressPixel;
+    Qt::MouseButton m_pressButton = Qt::NoButton;
+    bool m_pointerDragging = false;
+    bool m_hoverPending = false;
+    qint64 m_hoverIndex = -1;
+    QPointF m_hoverPixel;
+    qint64 m_shownHoverIndex = -1;
+    QPointF m_shownHoverPixel;
+    bool m_dragPending = false;
+    QPointF m_dragPixel;
+    Qt::MouseButtons m_dragButtons;
+    QTimer m_pointerTimer;
 
     QScrollArea* m_scrollArea;
-    QWidget* m_contentWidget;
-    QGridLayout* m_grid;
+    QImagesWidgetCanvas* m_contentWidget;
+
+    /**
+     * @brief 网格单元
+     */
+    struct Cell {
+        QImagesWidgetItemView* view = nullptr;
+        // 相对于图像居中位置的偏移，与场景尺寸无关
+        QPair<double, double> sceneOffset{0.0, 0.0};
+
+        // 当前显示的图像索引与缓存键，-1表示单元为空
+        qint64 imageIndex = -1;
+        QImagesPixmapKey pixmapKey;
+        bool dirty = true;
+
+        // 16位灰度图像缩放后、映射窗宽窗位前的结果，用于快速调整窗宽窗位
+        QImage windowSource;
+
+        // 原图尺寸，用于把鼠标位置映射为像素坐标，首次需要时读取
+        QSize sourceSize;
+    };
+
+    // 按行优先顺序保存的网格单元，尺寸为m_cellRows * m_cellCols
+    QVector<Cell> m_cells;
+    size_t m_cellRows = 0;
+    size_t m_cellCols = 0;
+
+    // 布局缩小时退役的视图，布局扩大时优先复用
+    QVector<QImagesWidgetItemView*> m_viewPool;
 
     void setupLayout();
-    QGridLayout* gridLayout() const;
+
+    /**
+     * @brief 按滚动区域的可见范围为单元分配或回收视图
+     */
+    void updateVisibleCells();
+    void onViewportChanged();
+
+    void onZoomRequested(double factor, const QPointF& anchor);
+    void onPanRequested(const QPointF& delta);
+
+    /**
+     * @brief 在下一帧把缩放和平移应用到所有视图，同一帧内的多次请求只应用一次
+     */
+    void scheduleNavigation();
+    void applyNavigation();
+
+    /**
+     * @brief 按当前缩放比例选择像素图的分辨率，变化时重新缩放可见单元
+     */
+    void updateDetailZoom();
+
+    /**
+     * @brief 可见单元的像素图尺寸，即场景尺寸乘以m_detailZoom
+     */
+    QSize renderSize() const;
+    QRect cellRect(size_t row, size_t col) const;
+
+    /**
+     * @brief BatchedBackend下绘制与区域相交的所有单元
+     */
+    void paintCells(QPainter& painter, const QRect& region);
+
+    /**
+     * @brief 内容控件坐标处拥有视图的单元，由网格间距直接计算
+     */
+    Cell* cellAtPos(const QPoint& pos);
+
+    /**
+     * @brief 处理单元视图或画布上的鼠标事件
+     * @param pos 内容控件坐标
+     */
+    void handlePointerEvent(QEvent::Type type, const QPoint& pos,
+                            Qt::MouseButton button, Qt::MouseButtons buttons);
+    void flushPointerSignals();
+
+    /**
+     * @brief 内容控件坐标对应的单元场景坐标，与视图的显示方式一致
+     */
+    QPointF cellScenePos(const Cell& cell, const QPoint& pos) const;
+
+    /**
+     * @brief 场景坐标对应的原图像素坐标
+     * @param inside 返回是否落在图像上
+     */
+    QPointF sourcePixel(Cell& cell, const QPointF& scenePos, bool* inside);
+
+    friend class QImagesWidgetCanvas;
+
+    /**
+     * @brief 整个图像序列被替换后回到第一页并重新绘制所有单元
+     */
+    void resetImages();
+    void onProviderCountChanged(size_t count);
+
+    /**
+     * @brief 获取指定图像缩放到场景尺寸后的像素图，优先从缓存读取
+     * @param key 返回实际使用的缓存键
+     * @param windowSource 图像为16位灰度时，返回映射窗宽窗位前的缩放结果；
+     *        命中缓存时从m_windowSourceCache读取，已被淘汰则为空
+     */
+    QPixmap scaledPixmap(size_t index, const QSize& size,
+                         QImagesPixmapKey* key = nullptr,
+                         QImage* windowSource = nullptr);
+    void insertPixmap(const QImagesPixmapKey& key, const QPixmap& pixmap);
+    void insertWindowSource(const QImagesPixmapKey& key, const QImage& image);
+    void removeCachedPixmaps(size_t index);
+    void refreshCell(Cell& cell, size_t index, const QSize& size);
+
+    /**
+     * @brief 图形层中某张图像的图元变化后，重绘正在显示该图像的单元
+     */
+    void onOverlayChanged(size_t index);
+    void onOverlayReset();
+    bool isPixmapKeyCurrent(const QImagesPixmapKey& key, size_t index,
+                            const QSize& size) const;
+
+    /**
+     * @brief 缩放与显示映射所需的参数快照，可以安全地传给工作线程
+     */
+    struct RenderOptions {
+        Qt::TransformationMode mode;
+        QImagesResampler::Filter filter;
+        QVector<uchar> windowLut;
+        QImagesProvider* provider;
+        QImagesMipmapCache* mipmaps;
+    };
+    RenderOptions renderOptions() const;
+
+    /**
+     * @brief 拼图所需的布局参数快照，可以传给工作线程
+     */
+    struct PageLayout {
+        size_t rows = 0;
+        size_t cols = 0;
+        QSize cellSize;
+        int horizontalSpacing = 0;
+        int verticalSpacing = 0;
+        QSizeF sceneSize;
+        size_t imageCount = 0;
+        QHash<size_t, QPointF> offsets; ///< 图像索引对应的场景偏移（相对于居中位置）
+    };
+
+    /**
+     * @brief 当前的布局，场景偏移取自当前显示各图像的单元
+     */
+    PageLayout pageLayout() const;
+
+    /**
+     * @brief 绘制一个单元中的图形项
+     * @details 参数依次为画家（布局坐标系，已裁剪到单元）、图像索引、单元矩形和
+     *          单元中可见的场景矩形
+     */
+    using OverlayPainter = std::function<void(QPainter*, size_t, const QRectF&,
+                                              const QRectF&)>;
+
+    /**
+     * @brief 将一页拼图中的一个区域绘制到画家上，renderPageRegion()和按页导出共用
+     * @details 不访问控件，可以在工作线程中调用；画家的原点对应区域的左上角
+     * @param overlays 绘制图形项的函数，可以为空
+     * @param cancelled 不为空且被置位时提前返回
+     */
+    static void paintPageRegion(QPainter* painter, const PageLayout& layout,
+                                size_t pageIndex, qreal scale,
+                                const QRect& region,
+                                const RenderOptions& options,
+                                const OverlayPainter& overlays,
+                                const QAtomicInt* cancelled = nullptr);
+
+    /**
+     * @brief 分块绘制单元中图像的可见部分
+     * @details 原图只读取一次，每块只取出所需的原图区域缩放，中间结果不超过一块
+     * @param target 整张图像在输出坐标系中的矩形
+     * @param visible 需要绘制的部分（输出坐标系）
+     */
+    static void paintImageTiles(QPainter* painter, size_t index,
+                                const QRectF& target, const QRect& visible,
+                                const RenderOptions& options,
+                                const QAtomicInt* cancelled);
+
+    /**
+     * @brief 进行中的批量导出
+     */
+    struct ExportBatch {
+        int id = 0;
+        bool active = false;
+        QString directory;
+        QByteArray format;
+        ExportMode mode = ExportPerImage;
+        size_t total = 0;
+        size_t next = 0;
+        size_t done = 0;
+        size_t written = 0;
+        int inFlight = 0;
+        QString errorString;
+        QSharedPointer<QAtomicInt> cancelled;
+        // 图像索引对应的图形项渲染结果，按图像导出时为包含图形项的原图，
+        // 按页导出时为单元尺寸、只有图形项的透明图像
+        QHash<size_t, QImage> overlays;
+        QHash<size_t, QVector<QImagesOverlayShape>> shapes; ///< 没有视图的图像的图元副本
+        QElapsedTimer clock;
+        QSize pageSize;
+        PageLayout layout;
+        RenderOptions options;
+    };
+    ExportBatch m_exportBatch;
+    QThreadPool m_exportPool;
+
+    void submitExportJobs();
+    void finishExportJob(int batchId, bool ok, const QString& errorString);
+
+    /**
+     * @brief 停止批量导出但不发出exportAllFinished，供析构使用
+     * @return 是否有正在进行的导出
+     */
+    bool abortExportAll();
+
+    /**
+     * @brief 在工作线程中渲染一个导出文件的图像，ExportPerPage时为整页拼图
+     */
+    static QImage renderExportUnit(const ExportBatch& batch, size_t unit);
+
+    static QImage scaleImage(const QImage& image, const QSize& size,
+                             const RenderOptions& options);
+
+    /**
+     * @brief 读取指定图像，缩放并转换为可直接显示的图像
+     * @details 16位灰度图像先缩放再通过查找表映射为8位，映射前的结果写入windowSource
+     */
+    static QImage renderImage(size_t index, const QSize& size,
+                              const RenderOptions& options,
+                              QImage* windowSource);
+    /**
+     * @brief 读取全分辨率的原图，16位灰度图像经过窗宽窗位映射
+     */
+    static QImage sourceImage(size_t index, const RenderOptions& options);
+    static QImage applyWindowLut(const QImage& image,
+                                 const QVector<uchar>& windowLut);
+    void updateWindowLut();
+
+    /**
+     * @brief 为当前页前后的页面提交后台缩放任务
+     */
+    void schedulePrefetch(const QSize& size);
+
+    /**
+     * @brief 撤销预取窗口外仍在排队的任务
+     * @details 已开始运行的任务保留登记，结果照常进入缓存
+     * @param wanted 新预取窗口内的键
+     */
+    void trimPrefetch(const QSet<QImagesPixmapKey>& wanted);
+
+    /**
+     * @brief 取消所有预取任务，已在运行的任务结果将被丢弃
+     * @details 只在缓存键对应的内容变化时调用，例如图像、缩放尺寸或窗宽窗位变化
+     */
+    void cancelPrefetch();
+
+    /**
+     * @brief 取消电影播放的预渲染任务并清空环形缓冲区
+     * @details 只在预渲染的来源变化时调用，例如图像、缩放尺寸、缩放方式、播放步进或
+     *          缓冲区大小变化，以及暂停播放。翻页和调整窗宽窗位不会清空缓冲区
+     */
+    void cancelCineFrames();
+    void finishPrefetch(const QImagesPixmapKey& key,
+                        const QSharedPointer<QAtomicInt>& state,
+                        const QImage& image, const QImage& windowSource);
+
+    void onCineTick();
+
+    /**
+     * @brief 计算播放方向上的下一帧，到达首尾时按循环模式处理
+     * @param stopped PlayOnce到达末尾时设为true
+     */
+    size_t nextCineFrame(size_t frame, int& direction, bool* stopped) const;
+    size_t cineFrameFirstImage(size_t frame) const;
+    void showCineFrame(size_t frame);
+
+    /**
+     * @brief 从当前帧起按播放方向接下来的帧，最多为环形缓冲区的大小
+     */
+    QVector<size_t> upcomingCineFrames() const;
+
+    /**
+     * @brief 为接下来的若干帧提交预渲染任务，已缓存、已渲染或正在渲染的图像不会重复缩放
+     */
+    void scheduleCineFrames();
+    void finishCineFrame(const QVector<QImagesPixmapKey>& keys, int generation,
+                         const CineImages& images, double latencyMs);
+
+    /**
+     * @brief 清除不在接下来若干帧中的缓冲区槽位，并释放不再需要的预渲染图像
+     */
+    void trimCineFrames();
     
+    /**
+     * @brief updateMarkers()的实际实现，刷新拥有视图且内容已过期的单元
+     */
+    void refreshVisibleCells();
+
     bool isValidIndex(int row, int col) const;
+
+    /**
+     * @brief 网格的行数，连续滚动时为容纳所有图像的行数
+     */
+    size_t gridRows() const;
+
+    /**
+     * @brief 第0行第0列单元对应的图像索引
+     */
+    size_t firstImageIndex() const;
+    const Cell* cellAt(int row, int col) const;
+
+    QImagesWidgetItemView* acquireView();
+    void configureView(Cell& cell, size_t row, size_t col);
+    void retireView(QImagesWidgetItemView* view);
 };
 
 #endif // QIMAGESWIDGET_H
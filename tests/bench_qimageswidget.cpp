@@ -0,0 +1,386 @@
+#include "qimageswidget.h"
+
+#include <QApplication>
+#include <QGraphicsPathItem>
+#include <QPainterPath>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QtTest>
+
+namespace {
+
+// 整页的边长（像素），单元边长为pageSide / grid
+constexpr int pageSide = 1024;
+
+// 每种尺寸只生成这么多张不同的图像，其余为共享数据的副本，内存不随网格增长
+constexpr int distinctImages = 4;
+
+QImage makeImage(int side, QImage::Format format, int seed) {
+    // 渐变叠加纹理，避免缩放和编码走纯色的快速路径
+    QImage image(side, side, format);
+    for (int y = 0; y < side; y++) {
+        uchar *line = image.scanLine(y);
+        for (int x = 0; x < side; x++) {
+            int value = (x + y + seed * 37) ^ ((x * y) >> 4);
+            switch (format) {
+            case QImage::Format_Grayscale8:
+                line[x] = static_cast<uchar>(value);
+                break;
+            case QImage::Format_Grayscale16:
+                reinterpret_cast<quint16 *>(line)[x] =
+                    static_cast<quint16>(value * 64);
+                break;
+            default:
+                reinterpret_cast<QRgb *>(line)[x] =
+                    qRgb(value & 0xff, (value >> 1) & 0xff, (value >> 2) & 0xff);
+                break;
+            }
+        }
+    }
+    return image;
+}
+
+QList<QImage> makeImages(int count, int side, QImage::Format format) {
+    QVector<QImage> distinct;
+    for (int i = 0; i < distinctImages; i++) {
+        distinct.append(makeImage(side, format, i));
+    }
+    QList<QImage> images;
+    images.reserve(count);
+    for (int i = 0; i < count; i++) {
+        images.append(distinct[i % distinctImages]);
+    }
+    return images;
+}
+
+/**
+ * @brief 设置grid×grid的网格和pages页图像，禁用预取以免后台任务干扰计时
+ */
+void setupWidget(QImagesWidget &widget, int grid, int side,
+                 QImage::Format format, int pages = 2) {
+    int cell = pageSide / grid;
+    widget.setPrefetchDepth(0);
+    widget.setViewWidth(static_cast<size_t>(cell));
+    widget.setViewHeight(static_cast<size_t>(cell));
+    widget.setRowNum(static_cast<size_t>(grid));
+    widget.setColNum(static_cast<size_t>(grid));
+    widget.setImages(makeImages(grid * grid * pages, side, format));
+}
+
+void showWidget(QImagesWidget &widget) {
+    // 留出滚动区域边框的空间，整页都在视口内
+    widget.resize(pageSide + 64, pageSide + 64);
+    widget.show();
+}
+
+/**
+ * @brief 网格1x1到16x16、图像256²到2048²、Gray8/Gray16/RGB32的组合
+ */
+void addMatrix() {
+    QTest::addColumn<int>("grid");
+    QTest::addColumn<int>("side");
+    QTest::addColumn<int>("format");
+
+    const QVector<QPair<const char *, QImage::Format>> formats{
+        {"gray8", QImage::Format_Grayscale8},
+        {"gray16", QImage::Format_Grayscale16},
+        {"rgb32", QImage::Format_RGB32}};
+    for (int grid : {1, 4, 16}) {
+        for (int side : {256, 512, 1024, 2048}) {
+            for (const auto &format : formats) {
+                QTest::addRow("%dx%d/%d/%s", grid, grid, side, format.first)
+                    << grid << side << static_cast<int>(format.second);
+            }
+        }
+    }
+}
+
+} // namespace
+
+/**
+ * @brief QImagesWidget热点路径的基准测试
+ *
+ * 在offscreen平台下运行，不需要显示器。使用QtTest的-csv或-xml选项输出
+ * 机器可读的结果，-callgrind、-tickcounter等选项切换计量方式。
+ */
+class QImagesWidgetBench : public QObject
+{
+    Q_OBJECT
+private slots:
+    /**
+     * @brief 每次翻页前清空缓存，所有单元从原图重新缩放
+     */
+    void pagingCold_data();
+    void pagingCold();
+
+    /**
+     * @brief 两页都在缓存中，翻页只替换像素图
+     */
+    void pagingWarm_data();
+    void pagingWarm();
+
+    /**
+     * @brief 在grid×grid和grid×(grid+1)之间切换，包括updateGrid()和视图复用
+     */
+    void layoutChange_data();
+    void layoutChange();
+
+    /**
+     * @brief 重绘整页，对比逐个视图绘制与一次绘制所有单元的两种后端
+     */
+    void repaint_data();
+    void repaint();
+
+    /**
+     * @brief 重绘整页，每张图像带有大量图元，对比图形层模型与逐个添加的图形项
+     */
+    void overlays_data();
+    void overlays();
+
+    /**
+     * @brief 拼接一页的导出图像
+     */
+    void renderPage_data();
+    void renderPage();
+
+    /**
+     * @brief 在线程池中按页导出到临时目录，包括读取、缩放、拼接和编码
+     */
+    void exportPages_data();
+    void exportPages();
+
+    /**
+     * @brief 单张图像缩小到约1/3，对比各滤波器与QImage::scaled的平滑缩放
+     */
+    void resample_data();
+    void resample();
+};
+
+void QImagesWidgetBench::pagingCold_data() { addMatrix(); }
+
+void QImagesWidgetBench::pagingCold() {
+    QFETCH(int, grid);
+    QFETCH(int, side);
+    QFETCH(int, format);
+    QImagesWidget widget;
+    setupWidget(widget, grid, side, static_cast<QImage::Format>(format));
+
+    size_t page = 0;
+    QBENCHMARK {
+        widget.clearPixmapCache();
+        page ^= 1;
+        widget.setPageIndex(page);
+    }
+}
+
+void QImagesWidgetBench::pagingWarm_data() { addMatrix(); }
+
+void QImagesWidgetBench::pagingWarm() {
+    QFETCH(int, grid);
+    QFETCH(int, side);
+    QFETCH(int, format);
+    QImagesWidget widget;
+    setupWidget(widget, grid, side, static_cast<QImage::Format>(format));
+    widget.setPageIndex(1);
+    widget.setPageIndex(0);
+    widget.resetPixmapCacheStats();
+
+    size_t page = 0;
+    QBENCHMARK {
+        page ^= 1;
+        widget.setPageIndex(page);
+    }
+    QCOMPARE(widget.pixmapCacheMisses(), quint64(0));
+}
+
+void QImagesWidgetBench::layoutChange_data() { addMatrix(); }
+
+void QImagesWidgetBench::layoutChange() {
+    QFETCH(int, grid);
+    QFETCH(int, side);
+    QFETCH(int, format);
+    QImagesWidget widget;
+    setupWidget(widget, grid, side, static_cast<QImage::Format>(format));
+
+    auto cols = static_cast<size_t>(grid);
+    QBENCHMARK {
+        widget.setColNum(widget.colNum() == cols ? cols + 1 : cols);
+    }
+}
+
+void QImagesWidgetBench::repaint_data() {
+    QTest::addColumn<int>("grid");
+    QTest::addColumn<int>("backend");
+
+    for (int grid : {1, 4, 16}) {
+        QTest::addRow("%dx%d/widget", grid, grid)
+            << grid << static_cast<int>(QImagesWidget::WidgetBackend);
+        QTest::addRow("%dx%d/batched", grid, grid)
+            << grid << static_cast<int>(QImagesWidget::BatchedBackend);
+    }
+}
+
+void QImagesWidgetBench::repaint() {
+    QFETCH(int, grid);
+    QFETCH(int, backend);
+    QImagesWidget widget;
+    widget.setRenderBackend(static_cast<QImagesWidget::RenderBackend>(backend));
+    setupWidget(widget, grid, 256, QImage::Format_Grayscale8);
+    showWidget(widget);
+    QVERIFY(QTest::qWaitForWindowExposed(&widget));
+
+    // 像素图都已缓存，只测量绘制本身
+    QBENCHMARK {
+        auto pixmap = widget.grab();
+        Q_UNUSED(pixmap);
+    }
+}
+
+void QImagesWidgetBench::overlays_data() {
+    QTest::addColumn<int>("grid");
+    QTest::addColumn<int>("shapes");
+    QTest::addColumn<bool>("items");
+
+    for (int grid : {1, 4, 16}) {
+        for (int shapes : {100, 1000, 10000}) {
+            QTest::addRow("%dx%d/%d/model", grid, grid, shapes)
+                << grid << shapes << false;
+            // 每个图形项约占几百字节，一万个图元乘以256个单元时内存过大
+            if (shapes <= 1000) {
+                QTest::addRow("%dx%d/%d/items", grid, grid, shapes)
+                    << grid << shapes << true;
+            }
+        }
+    }
+}
+
+void QImagesWidgetBench::overlays() {
+    QFETCH(int, grid);
+    QFETCH(int, shapes);
+    QFETCH(bool, items);
+    QImagesWidget widget;
+    setupWidget(widget, grid, 256, QImage::Format_Grayscale8);
+    showWidget(widget);
+    QVERIFY(QTest::qWaitForWindowExposed(&widget));
+
+    // 每张图像shapes条短折线，散布在整个场景中，场景原点为图像中心
+    int cell = pageSide / grid;
+    QPen pen(Qt::green, 0);
+    for (int index = 0; index < grid * grid; index++) {
+        QVector<QImagesOverlayShape> list;
+        for (int i = 0; i < shapes; i++) {
+            qreal x = (i * 37 + index) % cell - cell / 2.0;
+            qreal y = (i * 91 + index) % cell - cell / 2.0;
+            QVector<QPointF> points{{x, y}, {x + 3, y + 2}, {x + 5, y - 1}};
+            if (items) {
+                QPainterPath path(points[0]);
+                path.lineTo(points[1]);
+                path.lineTo(points[2]);
+                auto item = new QGraphicsPathItem(path);
+                item->setPen(pen);
+                QVERIFY(widget.addItem(index, item));
+            } else {
+                list.append(QImagesOverlayShape(QImagesOverlayShape::Polyline,
+                                                points, pen));
+            }
+        }
+        widget.overlayModel()->addShapes(static_cast<size_t>(index), list);
+    }
+
+    QBENCHMARK {
+        auto pixmap = widget.grab();
+        Q_UNUSED(pixmap);
+    }
+}
+
+void QImagesWidgetBench::renderPage_data() { addMatrix(); }
+
+void QImagesWidgetBench::renderPage() {
+    QFETCH(int, grid);
+    QFETCH(int, side);
+    QFETCH(int, format);
+    QImagesWidget widget;
+    setupWidget(widget, grid, side, static_cast<QImage::Format>(format));
+
+    QBENCHMARK {
+        auto page = widget.renderPage(0);
+        QVERIFY(!page.isNull());
+    }
+}
+
+void QImagesWidgetBench::exportPages_data() { addMatrix(); }
+
+void QImagesWidgetBench::exportPages() {
+    QFETCH(int, grid);
+    QFETCH(int, side);
+    QFETCH(int, format);
+    QImagesWidget widget;
+    setupWidget(widget, grid, side, static_cast<QImage::Format>(format));
+
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    QSignalSpy finished(&widget, &QImagesWidget::exportAllFinished);
+
+    // BMP编码几乎不耗时，结果主要反映读取、缩放和拼接
+    QBENCHMARK {
+        QVERIFY(widget.exportAll(directory.path(), "bmp", false,
+                                 QImagesWidget::ExportPerPage));
+        QVERIFY(finished.wait(600000));
+    }
+    QVERIFY(finished.last().at(0).toBool());
+}
+
+void QImagesWidgetBench::resample_data() {
+    QTest::addColumn<int>("side");
+    QTest::addColumn<int>("format");
+    QTest::addColumn<int>("filter");
+
+    // filter为-1时使用QImage::scaled(Qt::SmoothTransformation)作为参照
+    const QVector<QPair<const char *, QImage::Format>> formats{
+        {"gray8", QImage::Format_Grayscale8},
+        {"gray16", QImage::Format_Grayscale16},
+        {"rgb32", QImage::Format_RGB32}};
+    const QVector<QPair<const char *, int>> filters{
+        {"box", QImagesResampler::Box},
+        {"bilinear", QImagesResampler::Bilinear},
+        {"lanczos", QImagesResampler::Lanczos},
+        {"qt", -1}};
+    for (int side : {512, 1024, 2048}) {
+        for (const auto &format : formats) {
+            for (const auto &filter : filters) {
+                QTest::addRow("%d/%s/%s", side, format.first, filter.first)
+                    << side << static_cast<int>(format.second) << filter.second;
+            }
+        }
+    }
+}
+
+void QImagesWidgetBench::resample() {
+    QFETCH(int, side);
+    QFETCH(int, format);
+    QFETCH(int, filter);
+    auto image = makeImage(side, static_cast<QImage::Format>(format), 0);
+    QSize size(side / 3, side / 3);
+
+    QBENCHMARK {
+        auto result =
+            filter < 0
+                ? image.scaled(size, Qt::IgnoreAspectRatio,
+                               Qt::SmoothTransformation)
+                : QImagesResampler::resample(
+                      image, size, static_cast<QImagesResampler::Filter>(filter));
+        QVERIFY(!result.isNull());
+    }
+}
+
+int main(int argc, char *argv[]) {
+    // 默认在offscreen平台下运行，可以通过环境变量改为其他平台
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    QImagesWidgetBench bench;
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "bench_qimageswidget.moc"
@@ -0,0 +1,483 @@
+#include "qimagesresampler.h"
+
+#include <QtTest>
+
+#include <cmath>
+
+namespace {
+
+// ARGB32在内存中的字节顺序取决于字节序
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+constexpr int alphaChannel = 3;
+#else
+constexpr int alphaChannel = 0;
+#endif
+
+/**
+ * @brief 平缓变化的灰度图像，缩放结果不受采样相位的细微差别影响
+ */
+QImage makeSmoothImage(const QSize &size) {
+    QImage image(size, QImage::Format_Grayscale8);
+    for (int y = 0; y < size.height(); y++) {
+        uchar *line = image.scanLine(y);
+        for (int x = 0; x < size.width(); x++) {
+            double value = 128.0 + 90.0 * std::sin(x / 23.0) * std::cos(y / 31.0) +
+                           30.0 * (x + y) / (size.width() + size.height());
+            line[x] = static_cast<uchar>(qBound(0.0, value, 255.0));
+        }
+    }
+    return image;
+}
+
+/**
+ * @brief 带边缘和纹理的测试图像，所有通道都不相同
+ * @details ARGB32_Premultiplied的颜色不超过alpha
+ */
+QImage makePatternImage(const QSize &size, QImage::Format format) {
+    QImage image(size, format);
+    for (int y = 0; y < size.height(); y++) {
+        uchar *line = image.scanLine(y);
+        for (int x = 0; x < size.width(); x++) {
+            int value = ((x * 7 + y * 13) ^ (x * y)) & 0xff;
+            // 左右两半之间有一条硬边，Lanczos在此产生负瓣
+            if (x < size.width() / 2) {
+                value /= 4;
+            }
+            switch (format) {
+            case QImage::Format_Grayscale8:
+                line[x] = static_cast<uchar>(value);
+                break;
+            case QImage::Format_Grayscale16:
+                reinterpret_cast<quint16 *>(line)[x] =
+                    static_cast<quint16>(value * 256 + (x * 31 + y) % 256);
+                break;
+            case QImage::Format_ARGB32_Premultiplied:
+                reinterpret_cast<QRgb *>(line)[x] = qPremultiply(
+                    qRgba(value, 255 - value, (x * 5) & 0xff, (y * 11 + 40) & 0xff));
+                break;
+            default:
+                reinterpret_cast<QRgb *>(line)[x] =
+                    qRgb(value, 255 - value, (x * 5 + y * 3) & 0xff);
+                break;
+            }
+        }
+    }
+    return image;
+}
+
+/**
+ * @brief 两张图像的像素数据是否逐字节相同，不比较行尾的填充字节
+ */
+bool sameBytes(const QImage &a, const QImage &b, QString *where) {
+    if (a.size() != b.size() || a.format() != b.format()) {
+        *where = "size or format";
+        return false;
+    }
+    int bytes = a.width() * a.depth() / 8;
+    for (int y = 0; y < a.height(); y++) {
+        const uchar *lineA = a.constScanLine(y);
+        const uchar *lineB = b.constScanLine(y);
+        for (int i = 0; i < bytes; i++) {
+            if (lineA[i] != lineB[i]) {
+                *where = QString("row %1, byte %2: %3 != %4")
+                             .arg(y).arg(i).arg(lineA[i]).arg(lineB[i]);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+double referenceSinc(double x) {
+    if (x == 0.0) {
+        return 1.0;
+    }
+    x *= 3.14159265358979323846;
+    return std::sin(x) / x;
+}
+
+/**
+ * @brief 参照实现的滤波器，与QImagesResampler独立编写
+ */
+double referenceKernel(QImagesResampler::Filter filter, double x) {
+    if (filter == QImagesResampler::Lanczos) {
+        return std::abs(x) < 3.0 ? referenceSinc(x) * referenceSinc(x / 3.0)
+                                 : 0.0;
+    }
+    return qMax(0.0, 1.0 - std::abs(x));
+}
+
+/**
+ * @brief 一个方向上每个输出坐标对所有输入坐标的归一化权重
+ * @details 像素中心对齐，缩小时滤波器按比例展宽，超出边界的部分丢弃后重新归一化
+ */
+QVector<QVector<double>> referenceWeights(int inSize, int outSize,
+                                          QImagesResampler::Filter filter) {
+    double scale = static_cast<double>(inSize) / outSize;
+    double filterScale = qMax(scale, 1.0);
+    QVector<QVector<double>> result(outSize, QVector<double>(inSize, 0.0));
+    for (int i = 0; i < outSize; i++) {
+        double center = (i + 0.5) * scale;
+        double total = 0.0;
+        for (int j = 0; j < inSize; j++) {
+            result[i][j] = referenceKernel(filter, (j + 0.5 - center) / filterScale);
+            total += result[i][j];
+        }
+        for (int j = 0; j < inSize; j++) {
+            result[i][j] /= total;
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief 以双精度计算的参照重采样结果，每个像素channels个通道
+ */
+QVector<double> referenceResample(const QImage &image, const QSize &size,
+                                  QImagesResampler::Filter filter,
+                                  int channels) {
+    auto wy = referenceWeights(image.height(), size.height(), filter);
+    auto wx = referenceWeights(image.width(), size.width(), filter);
+    auto sample = [&image, channels](int x, int y, int c) -> double {
+        const uchar *line = image.constScanLine(y);
+        if (image.format() == QImage::Format_Grayscale16) {
+            return reinterpret_cast<const quint16 *>(line)[x];
+        }
+        return line[x * channels + c];
+    };
+
+    // 先纵向后横向
+    QVector<double> rows(size.height() * image.width() * channels, 0.0);
+    for (int y = 0; y < size.height(); y++) {
+        for (int j = 0; j < image.height(); j++) {
+            double weight = wy[y][j];
+            if (weight == 0.0) {
+                continue;
+            }
+            for (int x = 0; x < image.width(); x++) {
+                for (int c = 0; c < channels; c++) {
+                    rows[(y * image.width() + x) * channels + c] +=
+                        weight * sample(x, j, c);
+                }
+            }
+        }
+    }
+
+    QVector<double> result(size.height() * size.width() * channels, 0.0);
+    for (int y = 0; y < size.height(); y++) {
+        for (int x = 0; x < size.width(); x++) {
+            for (int j = 0; j < image.width(); j++) {
+                double weight = wx[x][j];
+                if (weight == 0.0) {
+                    continue;
+                }
+                for (int c = 0; c < channels; c++) {
+                    result[(y * size.width() + x) * channels + c] +=
+                        weight * rows[(y * image.width() + j) * channels + c];
+                }
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief 两张同尺寸灰度图像逐像素的最大差值
+ */
+int maxDifference(const QImage &a, const QImage &b) {
+    int result = 0;
+    for (int y = 0; y < a.height(); y++) {
+        const uchar *lineA = a.constScanLine(y);
+        const uchar *lineB = b.constScanLine(y);
+        for (int x = 0; x < a.width(); x++) {
+            result = qMax(result, qAbs(lineA[x] - lineB[x]));
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+class QImagesResamplerTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    /**
+     * @brief 偶数倍缩小棋盘格时，Box的每个输出像素都是黑白各半的平均值
+     */
+    void boxAveragesArea_data();
+    void boxAveragesArea();
+
+    /**
+     * @brief Box缩小与QImage::scaled(Qt::SmoothTransformation)相差不超过±2个灰度级
+     */
+    void boxMatchesQtSmooth_data();
+    void boxMatchesQtSmooth();
+
+    /**
+     * @brief SSE2和AVX2内核与标量实现的结果逐字节一致
+     * @details 奇数宽度覆盖向量循环之后的尾部处理；CPU不支持的宽度跳过
+     */
+    void simdMatchesScalar_data();
+    void simdMatchesScalar();
+
+    /**
+     * @brief Bilinear和Lanczos与双精度的参照实现相差不超过1
+     */
+    void matchesReference_data();
+    void matchesReference();
+
+    /**
+     * @brief Grayscale16保持16位精度，相差不到一个8位灰度级的输入仍能区分
+     */
+    void grayscale16KeepsPrecision_data();
+    void grayscale16KeepsPrecision();
+
+    void cleanup();
+};
+
+void QImagesResamplerTest::boxAveragesArea_data() {
+    QTest::addColumn<int>("factor");
+
+    for (int factor : {2, 4, 8}) {
+        QTest::addRow("1/%d", factor) << factor;
+    }
+}
+
+void QImagesResamplerTest::boxAveragesArea() {
+    QFETCH(int, factor);
+
+    QImage image(256, 256, QImage::Format_Grayscale8);
+    for (int y = 0; y < image.height(); y++) {
+        uchar *line = image.scanLine(y);
+        for (int x = 0; x < image.width(); x++) {
+            line[x] = (x + y) % 2 ? 255 : 0;
+        }
+    }
+
+    auto result = QImagesResampler::resample(
+        image, image.size() / factor, QImagesResampler::Box);
+    QCOMPARE(result.size(), image.size() / factor);
+
+    // 点采样会得到0或255，面积平均为127.5
+    for (int y = 0; y < result.height(); y++) {
+        const uchar *line = result.constScanLine(y);
+        for (int x = 0; x < result.width(); x++) {
+            QVERIFY2(line[x] == 127 || line[x] == 128,
+                     qPrintable(QString("(%1, %2) = %3").arg(x).arg(y).arg(line[x])));
+        }
+    }
+}
+
+void QImagesResamplerTest::boxMatchesQtSmooth_data() {
+    QTest::addColumn<QSize>("from");
+    QTest::addColumn<QSize>("to");
+
+    QTest::addRow("512->256") << QSize(512, 512) << QSize(256, 256);
+    QTest::addRow("512->171") << QSize(512, 512) << QSize(171, 171);
+    QTest::addRow("1000x600->333x200") << QSize(1000, 600) << QSize(333, 200);
+    QTest::addRow("640x480->97x73") << QSize(640, 480) << QSize(97, 73);
+    QTest::addRow("2048->200") << QSize(2048, 2048) << QSize(200, 200);
+}
+
+void QImagesResamplerTest::boxMatchesQtSmooth() {
+    QFETCH(QSize, from);
+    QFETCH(QSize, to);
+
+    auto image = makeSmoothImage(from);
+    auto result = QImagesResampler::resample(image, to, QImagesResampler::Box);
+    auto expected = image.scaled(to, Qt::IgnoreAspectRatio,
+                                 Qt::SmoothTransformation)
+                        .convertToFormat(QImage::Format_Grayscale8);
+    QCOMPARE(result.size(), to);
+    QCOMPARE(result.format(), QImage::Format_Grayscale8);
+
+    int difference = maxDifference(result, expected);
+    QVERIFY2(difference <= 2,
+             qPrintable(QString("max difference %1").arg(difference)));
+}
+
+void QImagesResamplerTest::simdMatchesScalar_data() {
+    QTest::addColumn<int>("format");
+    QTest::addColumn<int>("filter");
+    QTest::addColumn<QSize>("from");
+    QTest::addColumn<QSize>("to");
+
+    const QVector<QPair<const char *, QImage::Format>> formats{
+        {"gray8", QImage::Format_Grayscale8},
+        {"gray16", QImage::Format_Grayscale16},
+        {"rgb32", QImage::Format_RGB32},
+        {"argb32pm", QImage::Format_ARGB32_Premultiplied}};
+    const QVector<QPair<const char *, QImagesResampler::Filter>> filters{
+        {"box", QImagesResampler::Box},
+        {"bilinear", QImagesResampler::Bilinear},
+        {"lanczos", QImagesResampler::Lanczos}};
+    // 宽度不是向量宽度的整数倍，缩小、放大和一边缩小一边放大
+    const QVector<QPair<QSize, QSize>> sizes{
+        {QSize(333, 97), QSize(101, 45)},
+        {QSize(37, 29), QSize(91, 67)},
+        {QSize(1001, 7), QSize(250, 13)}};
+    for (const auto &format : formats) {
+        for (const auto &filter : filters) {
+            for (const auto &size : sizes) {
+                QTest::addRow("%s/%s/%dx%d->%dx%d", format.first, filter.first,
+                              size.first.width(), size.first.height(),
+                              size.second.width(), size.second.height())
+                    << static_cast<int>(format.second)
+                    << static_cast<int>(filter.second) << size.first
+                    << size.second;
+            }
+        }
+    }
+}
+
+void QImagesResamplerTest::simdMatchesScalar() {
+    QFETCH(int, format);
+    QFETCH(int, filter);
+    QFETCH(QSize, from);
+    QFETCH(QSize, to);
+
+    auto image = makePatternImage(from, static_cast<QImage::Format>(format));
+    auto resample = [&]() {
+        return QImagesResampler::resample(
+            image, to, static_cast<QImagesResampler::Filter>(filter));
+    };
+
+    QCOMPARE(QImagesResampler::setSimdWidth(0), 0);
+    auto scalar = resample();
+    QCOMPARE(scalar.format(), image.format());
+
+    int compared = 0;
+    for (int width : {16, 32}) {
+        if (QImagesResampler::setSimdWidth(width) != width) {
+            continue;
+        }
+        QString where;
+        QVERIFY2(sameBytes(resample(), scalar, &where),
+                 qPrintable(QString("simd width %1, %2").arg(width).arg(where)));
+        compared++;
+    }
+    if (compared == 0) {
+        QSKIP("no SIMD kernels available on this CPU or build");
+    }
+}
+
+void QImagesResamplerTest::matchesReference_data() {
+    QTest::addColumn<int>("format");
+    QTest::addColumn<int>("filter");
+    QTest::addColumn<QSize>("from");
+    QTest::addColumn<QSize>("to");
+
+    const QVector<QPair<const char *, QImage::Format>> formats{
+        {"gray8", QImage::Format_Grayscale8},
+        {"gray16", QImage::Format_Grayscale16},
+        {"rgb32", QImage::Format_RGB32},
+        {"argb32pm", QImage::Format_ARGB32_Premultiplied}};
+    const QVector<QPair<const char *, QImagesResampler::Filter>> filters{
+        {"bilinear", QImagesResampler::Bilinear},
+        {"lanczos", QImagesResampler::Lanczos}};
+    const QVector<QPair<QSize, QSize>> sizes{
+        {QSize(201, 151), QSize(73, 51)},
+        {QSize(41, 31), QSize(97, 71)},
+        {QSize(121, 40), QSize(51, 89)}};
+    for (const auto &format : formats) {
+        for (const auto &filter : filters) {
+            for (const auto &size : sizes) {
+                QTest::addRow("%s/%s/%dx%d->%dx%d", format.first, filter.first,
+                              size.first.width(), size.first.height(),
+                              size.second.width(), size.second.height())
+                    << static_cast<int>(format.second)
+                    << static_cast<int>(filter.second) << size.first
+                    << size.second;
+            }
+        }
+    }
+}
+
+void QImagesResamplerTest::matchesReference() {
+    QFETCH(int, format);
+    QFETCH(int, filter);
+    QFETCH(QSize, from);
+    QFETCH(QSize, to);
+
+    auto image = makePatternImage(from, static_cast<QImage::Format>(format));
+    auto result = QImagesResampler::resample(
+        image, to, static_cast<QImagesResampler::Filter>(filter));
+    QCOMPARE(result.size(), to);
+    QCOMPARE(result.format(), image.format());
+
+    bool gray16 = image.format() == QImage::Format_Grayscale16;
+    bool premultiplied = image.format() == QImage::Format_ARGB32_Premultiplied;
+    int channels = image.depth() == 32 ? 4 : 1;
+    double maxValue = gray16 ? 65535.0 : 255.0;
+    auto expected = referenceResample(
+        image, to, static_cast<QImagesResampler::Filter>(filter), channels);
+
+    for (int y = 0; y < to.height(); y++) {
+        const uchar *line = result.constScanLine(y);
+        for (int x = 0; x < to.width(); x++) {
+            const double *reference = expected.constData() +
+                                      (y * to.width() + x) * channels;
+            double alpha = premultiplied
+                               ? qBound(0.0, reference[alphaChannel], maxValue)
+                               : maxValue;
+            for (int c = 0; c < channels; c++) {
+                double value = qBound(0.0, reference[c], maxValue);
+                // Lanczos的负瓣可能使预乘颜色超过alpha，结果被限制到alpha
+                if (premultiplied && c != alphaChannel) {
+                    value = qMin(value, alpha);
+                }
+                int actual = gray16 ? reinterpret_cast<const quint16 *>(line)[x]
+                                    : line[x * channels + c];
+                QVERIFY2(std::abs(actual - value) <= 1.0,
+                         qPrintable(QString("(%1, %2) channel %3: %4, expected %5")
+                                        .arg(x).arg(y).arg(c).arg(actual)
+                                        .arg(value)));
+            }
+        }
+    }
+}
+
+void QImagesResamplerTest::grayscale16KeepsPrecision_data() {
+    QTest::addColumn<int>("filter");
+
+    QTest::addRow("box") << static_cast<int>(QImagesResampler::Box);
+    QTest::addRow("bilinear") << static_cast<int>(QImagesResampler::Bilinear);
+    QTest::addRow("lanczos") << static_cast<int>(QImagesResampler::Lanczos);
+}
+
+void QImagesResamplerTest::grayscale16KeepsPrecision() {
+    QFETCH(int, filter);
+
+    // 横向每像素只增加4，整幅图像的范围只相当于8位的8个灰度级
+    QImage image(512, 8, QImage::Format_Grayscale16);
+    for (int y = 0; y < image.height(); y++) {
+        auto line = reinterpret_cast<quint16 *>(image.scanLine(y));
+        for (int x = 0; x < image.width(); x++) {
+            line[x] = static_cast<quint16>(30000 + 4 * x);
+        }
+    }
+
+    auto result = QImagesResampler::resample(
+        image, QSize(256, 4), static_cast<QImagesResampler::Filter>(filter));
+    QCOMPARE(result.format(), QImage::Format_Grayscale16);
+
+    // 远离边缘处线性输入的滤波结果仍是线性的：输出x对应输入2x + 0.5
+    auto line = reinterpret_cast<const quint16 *>(result.constScanLine(2));
+    for (int x = 4; x < result.width() - 4; x++) {
+        double expected = 30000 + 4 * (2 * x + 0.5);
+        QVERIFY2(std::abs(line[x] - expected) <= 1.0,
+                 qPrintable(QString("x = %1: %2, expected %3")
+                                .arg(x).arg(line[x]).arg(expected)));
+        QCOMPARE(line[x] - line[x - 1], 8);
+    }
+}
+
+void QImagesResamplerTest::cleanup() {
+    // 恢复默认，不影响其他测试
+    QImagesResampler::setSimdWidth(32);
+}
+
+QTEST_GUILESS_MAIN(QImagesResamplerTest)
+
+#include "tst_qimagesresampler.moc"
@@ -0,0 +1,594 @@
+#include "qimageswidget.h"
+
+#include <QApplication>
+#include <QGraphicsRectItem>
+#include <QGraphicsScene>
+#include <QMutex>
+#include <QScopeGuard>
+#include <QSemaphore>
+#include <QThread>
+#include <QtTest>
+
+#include <limits>
+
+namespace {
+
+// 图像的边长（像素），单元边长为cellSide，缩放后的像素图大于原图
+constexpr int imageSide = 32;
+constexpr int cellSide = 64;
+
+QImage makeImage(QRgb color) {
+    QImage image(imageSide, imageSide, QImage::Format_RGB32);
+    image.fill(color);
+    return image;
+}
+
+QImage makeGray16Image(quint16 value, int step = 16) {
+    QImage image(imageSide, imageSide, QImage::Format_Grayscale16);
+    for (int y = 0; y < imageSide; y++) {
+        auto line = reinterpret_cast<quint16 *>(image.scanLine(y));
+        for (int x = 0; x < imageSide; x++) {
+            line[x] = static_cast<quint16>(value + x * step);
+        }
+    }
+    return image;
+}
+
+/**
+ * @brief 每张图像颜色不同，可以从显示的像素图判断显示的是哪一张
+ */
+QList<QImage> makeImages(int count) {
+    QList<QImage> images;
+    for (int i = 0; i < count; i++) {
+        images.append(makeImage(qRgb(i * 16, 255 - i * 16, 128)));
+    }
+    return images;
+}
+
+/**
+ * @brief 设置rows×cols的网格，图像在调用者设置数据源后才会显示
+ */
+void setupWidget(QImagesWidget &widget, int rows, int cols, int prefetchDepth) {
+    widget.setPrefetchDepth(prefetchDepth);
+    widget.setViewWidth(cellSide);
+    widget.setViewHeight(cellSide);
+    widget.setRowNum(static_cast<size_t>(rows));
+    widget.setColNum(static_cast<size_t>(cols));
+}
+
+QRgb centerPixel(const QImagesWidgetItemView *view) {
+    auto image = view->pixmap().toImage();
+    return image.pixel(image.width() / 2, image.height() / 2);
+}
+
+// 纯色图像缩放后各通道允许1的舍入误差
+bool sameColor(QRgb a, QRgb b) {
+    return qAbs(qRed(a) - qRed(b)) <= 1 && qAbs(qGreen(a) - qGreen(b)) <= 1 &&
+           qAbs(qBlue(a) - qBlue(b)) <= 1;
+}
+
+/**
+ * @brief 保存在内存中并记录每张图像读取次数的数据源
+ *
+ * setGate()之后，指定索引及之后的读取会先取出当时的图像，再阻塞到openGate()，
+ * 模拟解码期间图像被替换的情况，并让测试控制后台任务完成的时机
+ */
+class TestProvider : public QImagesProvider
+{
+public:
+    explicit TestProvider(const QList<QImage> &images)
+        : m_images(images), m_reads(images.size(), 0) {}
+
+    size_t count() const override {
+        QMutexLocker locker(&m_mutex);
+        return static_cast<size_t>(m_images.size());
+    }
+
+    QImage image(size_t index) const override {
+        QImage image;
+        {
+            QMutexLocker locker(&m_mutex);
+            if (index >= static_cast<size_t>(m_images.size())) {
+                return QImage();
+            }
+            image = m_images[static_cast<int>(index)];
+            m_reads[static_cast<int>(index)]++;
+            if (index < m_gateFirst) {
+                return image;
+            }
+            m_blocked++;
+        }
+        m_entered.release();
+        m_gate.acquire();
+        return image;
+    }
+
+    int reads(size_t index) const {
+        QMutexLocker locker(&m_mutex);
+        return m_reads[static_cast<int>(index)];
+    }
+
+    void setImage(size_t index, const QImage &image) {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_images[static_cast<int>(index)] = image;
+        }
+        emit imageChanged(index);
+    }
+
+    /**
+     * @brief 之后读取索引不小于first的图像时阻塞
+     */
+    void setGate(size_t first) {
+        QMutexLocker locker(&m_mutex);
+        m_gateFirst = first;
+    }
+
+    /**
+     * @brief 等待有读取进入阻塞
+     */
+    bool waitBlocked(int timeout = 5000) {
+        return m_entered.tryAcquire(1, timeout);
+    }
+
+    /**
+     * @brief 放行所有阻塞的读取，之后的读取不再阻塞
+     */
+    void openGate() {
+        int blocked = 0;
+        {
+            QMutexLocker locker(&m_mutex);
+            m_gateFirst = std::numeric_limits<size_t>::max();
+            blocked = m_blocked;
+            m_blocked = 0;
+        }
+        m_gate.release(blocked);
+    }
+
+private:
+    mutable QMutex m_mutex;
+    QList<QImage> m_images;
+    mutable QVector<int> m_reads;
+    size_t m_gateFirst = std::numeric_limits<size_t>::max();
+    mutable int m_blocked = 0;
+    mutable QSemaphore m_entered;
+    mutable QSemaphore m_gate;
+};
+
+/**
+ * @brief 统计投递给对象的排队调用
+ *
+ * 后台任务通过排队调用把结果交回主线程，计数达到提交的任务数时所有结果都已处理
+ */
+class QueuedCallCounter : public QObject
+{
+public:
+    explicit QueuedCallCounter(QObject *target) {
+        target->installEventFilter(this);
+    }
+
+    int count() const { return m_count; }
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override {
+        Q_UNUSED(watched);
+        if (event->type() == QEvent::MetaCall) {
+            m_count++;
+        }
+        return false;
+    }
+
+private:
+    int m_count = 0;
+};
+
+} // namespace
+
+/**
+ * @brief QImagesWidget的行为测试
+ *
+ * 在offscreen平台下运行，控件不需要显示，所有单元在设置图像后即拥有视图
+ */
+class TestQImagesWidget : public QObject
+{
+    Q_OBJECT
+private slots:
+    /**
+     * @brief 首次显示全部未命中，翻回已显示的页全部命中且不再读取数据源
+     */
+    void pixmapCacheHitsAndMisses();
+
+    /**
+     * @brief 缩放方式是缓存键的一部分，切换后未命中，切换回来命中原来的结果
+     */
+    void pixmapCacheKeyedByMode();
+
+    /**
+     * @brief 调整窗宽窗位后由缓存的16位缩放结果重新映射，计为命中且不读取数据源
+     */
+    void windowLevelReusesScaledSource();
+
+    /**
+     * @brief 默认窗宽窗位显示12位数据的完整范围
+     */
+    void defaultWindowCovers12Bit();
+
+    /**
+     * @brief 窗位为0时也能正确判断窗宽窗位是否变化
+     */
+    void windowLevelAtZero();
+
+    /**
+     * @brief 预取的结果进入缓存，翻页时直接命中
+     */
+    void prefetchFillsCache();
+
+    /**
+     * @brief 预取期间图像被替换，旧图像的结果被丢弃，翻页时重新读取新图像
+     */
+    void stalePrefetchDropped();
+
+    /**
+     * @brief 替换一张图像只重新缩放显示它的单元，其他单元和视图保持不变
+     */
+    void dirtyCellRefresh();
+
+    /**
+     * @brief 移动单元的场景不重新缩放图像，也不重建视图
+     */
+    void sceneOffsetKeepsPixmaps();
+
+    /**
+     * @brief 按图像播放时相邻帧共享的图像只渲染一次，已显示的图像不再提交
+     */
+    void cineDedupe();
+
+    /**
+     * @brief 暂停后仍在渲染的旧任务结果被丢弃，再次播放时重新提交
+     */
+    void cineGenerationCancel();
+
+    /**
+     * @brief 单次播放落后很多帧时停在末尾，丢帧数只计算实际跳过的帧
+     */
+    void cineDroppedFramesClamped();
+
+    /**
+     * @brief 追加图像不重置控件，已显示的单元保持原来的视图和像素图
+     */
+    void appendKeepsCells();
+
+    /**
+     * @brief 启用紧凑存储后灰色的32位图像按8位灰度保存，追加的图像同样转换
+     */
+    void compactStorageMemory();
+};
+
+void TestQImagesWidget::pixmapCacheHitsAndMisses() {
+    TestProvider provider(makeImages(8));
+    QImagesWidget widget;
+    setupWidget(widget, 2, 2, 0);
+    widget.setProvider(&provider);
+    QCOMPARE(widget.pixmapCacheMisses(), quint64(4));
+    QCOMPARE(widget.pixmapCacheHits(), quint64(0));
+
+    widget.resetPixmapCacheStats();
+    widget.setPageIndex(1);
+    QCOMPARE(widget.pixmapCacheMisses(), quint64(4));
+    QCOMPARE(widget.pixmapCacheHits(), quint64(0));
+
+    widget.resetPixmapCacheStats();
+    widget.setPageIndex(0);
+    QCOMPARE(widget.pixmapCacheMisses(), quint64(0));
+    QCOMPARE(widget.pixmapCacheHits(), quint64(4));
+    for (size_t index = 0; index < 8; index++) {
+        QCOMPARE(provider.reads(index), 1);
+    }
+
+    // 命中的像素图与之前显示的是同一张
+    QVERIFY(sameColor(centerPixel(widget.itemView(1, 1)),
+                      makeImages(8).at(3).pixel(0, 0)));
+}
+
+void TestQImagesWidget::pixmapCacheKeyedByMode() {
+    TestProvider provider(makeImages(4));
+    QImagesWidget widget;
+    setupWidget(widget, 2, 2, 0);
+    widget.setProvider(&provider);
+
+    widget.resetPixmapCacheStats();
+    widget.setTransformationMode(Qt::FastTransformation);
+    QCOMPARE(widget.pixmapCacheMisses(), quint64(4));
+    QCOMPARE(widget.pixmapCacheHits(), quint64(0));
+
+    widget.resetPixmapCacheStats();
+    widget.setTransformationMode(Qt::SmoothTransformation);
+    QCOMPARE(widget.pixmapCacheMisses(), quint64(0));
+    QCOMPARE(widget.pixmapCacheHits(), quint64(4));
+}
+
+void TestQImagesWidget::windowLevelReusesScaledSource() {
+    QList<QImage> images;
+    for (int i = 0; i < 8; i++) {
+        images.append(makeGray16Image(static_cast<quint16>(i * 1000)));
+    }
+    TestProvider provider(images);
+    QImagesWidget widget;
+    setupWidget(widget, 2, 2, 0);
+    widget.setProvider(&provider);
+    widget.setPageIndex(1);
+    widget.setPageIndex(0);
+
+    // 当前页直接重新映射，已离开的页翻回时命中16位缩放结果
+    widget.resetPixmapCacheStats();
+    widget.setWindowLevel(4000.0, 2000.0);
+    widget.setPageIndex(1);
+    QCOMPARE(widget.pixmapCacheMisses(), quint64(0));
+    QCOMPARE(widget.pixmapCacheHits(), quint64(4));
+    for (size_t index = 0; index < 8; index++) {
+        QCOMPARE(provider.reads(index), 1);
+    }
+}
+
+void TestQImagesWidget::defaultWindowCovers12Bit() {
+    QImagesWidget widget;
+    setupWidget(widget, 1, 3, 0);
+    widget.setImages({makeGray16Image(0, 0), makeGray16Image(2048, 0),
+                      makeGray16Image(4095, 0)});
+    QCOMPARE(widget.windowCenter(), 2048.0);
+    QCOMPARE(widget.windowWidth(), 4096.0);
+    QCOMPARE(qGray(centerPixel(widget.itemView(0, 0))), 0);
+    QVERIFY(qAbs(qGray(centerPixel(widget.itemView(0, 1))) - 128) <= 1);
+    QCOMPARE(qGray(centerPixel(widget.itemView(0, 2))), 255);
+}
+
+void TestQImagesWidget::windowLevelAtZero() {
+    QImagesWidget widget;
+    setupWidget(widget, 1, 1, 0);
+    widget.setImages({makeGray16Image(1, 0)});
+
+    widget.setWindowLevel(0.0, 2.0);
+    QCOMPARE(widget.windowCenter(), 0.0);
+    QCOMPARE(qGray(centerPixel(widget.itemView(0, 0))), 255);
+
+    // 相同的窗宽窗位不重新映射，窗位的微小变化照常生效
+    auto pixmap = widget.itemView(0, 0)->pixmap().cacheKey();
+    widget.setWindowLevel(0.0, 2.0);
+    QCOMPARE(widget.itemView(0, 0)->pixmap().cacheKey(), pixmap);
+    widget.setWindowLevel(1e-9, 2.0);
+    QCOMPARE(widget.windowCenter(), 1e-9);
+    QVERIFY(widget.itemView(0, 0)->pixmap().cacheKey() != pixmap);
+}
+
+void TestQImagesWidget::prefetchFillsCache() {
+    TestProvider provider(makeImages(12));
+    QImagesWidget widget;
+    QueuedCallCounter finished(&widget);
+    setupWidget(widget, 2, 2, 1);
+    widget.setProvider(&provider);
+
+    // 第0页之前没有页，只预取第1页的4张图像
+    QTRY_VERIFY(finished.count() >= 4);
+    widget.resetPixmapCacheStats();
+    widget.setPageIndex(1);
+    QCOMPARE(widget.pixmapCacheMisses(), quint64(0));
+    QCOMPARE(widget.pixmapCacheHits(), quint64(4));
+    for (size_t index = 4; index < 8; index++) {
+        QCOMPARE(provider.reads(index), 1);
+    }
+}
+
+void TestQImagesWidget::stalePrefetchDropped() {
+    TestProvider provider(makeImages(3));
+    provider.setGate(1);
+    QImagesWidget widget;
+    // 失败退出时也要放行，否则控件析构时等待后台任务会卡住
+    auto release = qScopeGuard([&provider]() { provider.openGate(); });
+    QueuedCallCounter finished(&widget);
+    setupWidget(widget, 1, 1, 1);
+    widget.setProvider(&provider);
+
+    // 预取已读到旧图像，仍在缩放时图像被替换
+    QVERIFY(provider.waitBlocked());
+    auto replacement = makeImage(qRgb(255, 0, 0));
+    provider.setImage(1, replacement);
+    provider.openGate();
+    QTRY_VERIFY(finished.count() >= 1);
+
+    widget.resetPixmapCacheStats();
+    widget.setPageIndex(1);
+    QCOMPARE(widget.pixmapCacheMisses(), quint64(1));
+    QCOMPARE(widget.pixmapCacheHits(), quint64(0));
+    QCOMPARE(provider.reads(1), 2);
+    QVERIFY(sameColor(centerPixel(widget.itemView(0, 0)),
+                      replacement.pixel(0, 0)));
+}
+
+void TestQImagesWidget::dirtyCellRefresh() {
+    QImagesWidget widget;
+    setupWidget(widget, 2, 2, 0);
+    widget.setImages(makeImages(4));
+
+    QVector<QImagesWidgetItemView *> views;
+    QVector<qint64> pixmaps;
+    for (int cell = 0; cell < 4; cell++) {
+        views.append(widget.itemView(cell / 2, cell % 2));
+        pixmaps.append(views.last()->pixmap().cacheKey());
+    }
+    auto item = new QGraphicsRectItem(0, 0, 4, 4);
+    QVERIFY(widget.addItem(0, 1, item));
+
+    widget.resetPixmapCacheStats();
+    auto replacement = makeImage(qRgb(255, 0, 0));
+    QVERIFY(widget.setImage(1, replacement));
+    QCOMPARE(widget.pixmapCacheMisses(), quint64(1));
+    QCOMPARE(widget.pixmapCacheHits(), quint64(0));
+    QVERIFY(sameColor(centerPixel(widget.itemView(0, 1)),
+                      replacement.pixel(0, 0)));
+
+    // 同一图像只替换像素图，调用者添加的图形项保留
+    QVERIFY(widget.scene(0, 1)->items().contains(item));
+    for (int cell = 0; cell < 4; cell++) {
+        auto view = widget.itemView(cell / 2, cell % 2);
+        QCOMPARE(view, views[cell]);
+        if (cell != 1) {
+            QCOMPARE(view->pixmap().cacheKey(), pixmaps[cell]);
+        }
+    }
+
+    // 没有脏单元时刷新不查找缓存
+    widget.resetPixmapCacheStats();
+    widget.updateMarkers();
+    QCOMPARE(widget.pixmapCacheMisses(), quint64(0));
+    QCOMPARE(widget.pixmapCacheHits(), quint64(0));
+}
+
+void TestQImagesWidget::sceneOffsetKeepsPixmaps() {
+    QImagesWidget widget;
+    setupWidget(widget, 2, 2, 0);
+    widget.setImages(makeImages(4));
+
+    auto view = widget.itemView(0, 0);
+    auto pixmap = view->pixmap().cacheKey();
+    auto neighbour = widget.sceneOffset(0, 1);
+
+    widget.resetPixmapCacheStats();
+    widget.setSceneOffset(0, 0, 8.0, 4.0);
+    QCOMPARE(widget.sceneOffset(0, 0), qMakePair(8.0, 4.0));
+    QCOMPARE(widget.sceneOffset(0, 1), neighbour);
+    QCOMPARE(widget.itemView(0, 0), view);
+    QCOMPARE(view->pixmap().cacheKey(), pixmap);
+    QCOMPARE(widget.pixmapCacheMisses(), quint64(0));
+    QCOMPARE(widget.pixmapCacheHits(), quint64(0));
+}
+
+void TestQImagesWidget::cineDedupe() {
+    TestProvider provider(makeImages(6));
+    QImagesWidget widget;
+    QueuedCallCounter finished(&widget);
+    setupWidget(widget, 1, 2, 0);
+    widget.setCineStep(QImagesWidget::ImageStep);
+    widget.setCineBufferFrames(4);
+    // 第一帧在1秒后才显示，测试期间只有预渲染
+    widget.setCineFps(1.0);
+    widget.setProvider(&provider);
+
+    // 第1到4帧显示图像1到5，图像1已经显示，其余每帧只有一张新图像
+    widget.play();
+    QTRY_VERIFY(finished.count() >= 4);
+    for (size_t index = 0; index < 6; index++) {
+        QCOMPARE(provider.reads(index), 1);
+    }
+    QVERIFY(widget.memoryStats().cineBytes > 0);
+    widget.pause();
+}
+
+void TestQImagesWidget::cineGenerationCancel() {
+    TestProvider provider(makeImages(3));
+    provider.setGate(1);
+    QImagesWidget widget;
+    auto release = qScopeGuard([&provider]() { provider.openGate(); });
+    QueuedCallCounter finished(&widget);
+    setupWidget(widget, 1, 1, 0);
+    widget.setCineBufferFrames(1);
+    widget.setCineFps(1.0);
+    widget.setProvider(&provider);
+
+    widget.play();
+    QVERIFY(provider.waitBlocked());
+    widget.pause();
+    provider.openGate();
+    QTRY_VERIFY(finished.count() >= 1);
+    QCOMPARE(widget.memoryStats().cineBytes, qint64(0));
+
+    // 旧任务的登记已随取消清空，再次播放会重新渲染
+    widget.play();
+    QTRY_VERIFY(finished.count() >= 2);
+    QCOMPARE(provider.reads(1), 2);
+    QVERIFY(widget.memoryStats().cineBytes > 0);
+    widget.pause();
+}
+
+void TestQImagesWidget::cineDroppedFramesClamped() {
+    QImagesWidget widget;
+    setupWidget(widget, 1, 1, 0);
+    widget.setImages(makeImages(3));
+    widget.setCineLoopMode(QImagesWidget::PlayOnce);
+    widget.setCineFps(1000.0);
+
+    // 阻塞事件循环，第一次检查时已落后约100帧，但只能从第0帧前进到第2帧
+    widget.play();
+    QThread::msleep(100);
+    QTRY_VERIFY(!widget.isPlaying());
+    QCOMPARE(widget.cineFrame(), size_t(2));
+    QVERIFY(widget.cineStats().framesDropped <= 1);
+}
+
+void TestQImagesWidget::appendKeepsCells() {
+    auto images = makeImages(6);
+    QImagesWidget widget;
+    setupWidget(widget, 2, 2, 0);
+    widget.setImages(images.mid(0, 3));
+
+    QVector<QImagesWidgetItemView *> views;
+    QVector<qint64> pixmaps;
+    for (int cell = 0; cell < 3; cell++) {
+        views.append(widget.itemView(cell / 2, cell % 2));
+        pixmaps.append(views.last()->pixmap().cacheKey());
+    }
+
+    QSignalSpy countChanged(&widget, &QImagesWidget::imageCountChanged);
+    widget.resetPixmapCacheStats();
+    widget.appendImages(images.mid(3));
+    QCOMPARE(countChanged.count(), 1);
+    QCOMPARE(countChanged.first().first().toULongLong(), 6ULL);
+    QCOMPARE(widget.imageCount(), size_t(6));
+    QCOMPARE(widget.pageIndex(), size_t(0));
+    QCOMPARE(widget.pageCount(), size_t(2));
+
+    // 只有原来空着的最后一个单元需要缩放
+    QCOMPARE(widget.pixmapCacheMisses(), quint64(1));
+    QCOMPARE(widget.pixmapCacheHits(), quint64(0));
+    QVERIFY(sameColor(centerPixel(widget.itemView(1, 1)),
+                      images.at(3).pixel(0, 0)));
+    for (int cell = 0; cell < 3; cell++) {
+        auto view = widget.itemView(cell / 2, cell % 2);
+        QCOMPARE(view, views[cell]);
+        QCOMPARE(view->pixmap().cacheKey(), pixmaps[cell]);
+    }
+}
+
+void TestQImagesWidget::compactStorageMemory() {
+    QList<QImage> images;
+    for (int i = 0; i < 4; i++) {
+        images.append(makeImage(qRgb(i * 32, i * 32, i * 32)));
+    }
+    QImagesWidget widget;
+    setupWidget(widget, 2, 2, 0);
+    widget.setCompactStorageEnabled(true);
+    widget.setImages(images);
+
+    const qint64 grayBytes = imageSide * imageSide;
+    QCOMPARE(widget.imageAt(0).format(), QImage::Format_Grayscale8);
+    QCOMPARE(widget.memoryStats().sourceBytes, 4 * grayBytes);
+
+    // 彩色图像无法无损转换，保持原格式
+    auto color = makeImage(qRgb(255, 0, 0));
+    widget.appendImages({makeImage(qRgb(200, 200, 200)), color});
+    QCOMPARE(widget.imageAt(4).format(), QImage::Format_Grayscale8);
+    QCOMPARE(widget.imageAt(5).format(), QImage::Format_RGB32);
+    QCOMPARE(widget.memoryStats().sourceBytes,
+             5 * grayBytes + color.sizeInBytes());
+}
+
+int main(int argc, char *argv[]) {
+    // 默认在offscreen平台下运行，可以通过环境变量改为其他平台
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    TestQImagesWidget test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_qimageswidget.moc"
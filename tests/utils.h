@@ -0,0 +1,10 @@
+#ifndef UTILS_H
+#define UTILS_H
+
+// 独立构建测试时代替上层项目mrscan2的utils.h，只提供控件用到的日志宏
+
+#include <QDebug>
+
+#define LOG_ERROR(message) qWarning() << (message)
+
+#endif // UTILS_H